@@ -0,0 +1,17 @@
+#include "arena.h"
+
+#include <algorithm>
+
+arena::~arena() {
+	for (auto record = destructors; record != nullptr; record = record->next) {
+		record->destroy(record->object);
+	}
+}
+
+void* arena::allocate_slow(size_t size, size_t alignment) {
+	size_t block_size = std::max(BLOCK_SIZE, size + alignment);
+	blocks.push_back(std::unique_ptr<std::byte[]>(new std::byte[block_size])); // (not make_unique, that would zero it)
+	current = blocks.back().get();
+	end = current + block_size;
+	return allocate(size, alignment);
+}
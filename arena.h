@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// bump allocator for things that live exactly as long as a compilation, like AST nodes.
+// allocating is (almost always) just moving a pointer forward, and nothing is freed until the whole arena is.
+class arena {
+public:
+	arena() = default;
+	~arena();
+
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	// constructs a T in the arena. if T isn't trivially destructible, its destructor runs when the arena is destroyed.
+	template <typename T, typename... Args>
+	T* make(Args&&... args) {
+		T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			auto record = new (allocate(sizeof(destructor_record), alignof(destructor_record))) destructor_record{
+				.destroy = [](void* p) { static_cast<T*>(p)->~T(); },
+				.object = object,
+				.next = destructors
+			};
+			destructors = record;
+		}
+		return object;
+	}
+
+	// uninitialized memory that lives as long as the arena
+	void* allocate(size_t size, size_t alignment) {
+		size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+		if (current == nullptr || static_cast<size_t>(end - current) < padding + size) return allocate_slow(size, alignment);
+		std::byte* memory = current + padding;
+		current = memory + size;
+		return memory;
+	}
+
+private:
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+	// objects with destructors are kept in a linked list (in the arena itself, newest first) so they can be destroyed in reverse order
+	struct destructor_record {
+		void (*destroy)(void*);
+		void* object;
+		destructor_record* next;
+	};
+
+	std::vector<std::unique_ptr<std::byte[]>> blocks;
+	std::byte* current = nullptr;
+	std::byte* end = nullptr;
+	destructor_record* destructors = nullptr;
+
+	// starts a new block, big enough for the allocation
+	void* allocate_slow(size_t size, size_t alignment);
+};
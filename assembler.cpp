@@ -0,0 +1,387 @@
+#include "assembler.h"
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "mcasm.h"
+
+static const std::unordered_map<std::string_view, value_type> value_types = {
+	{ "sint", value_type::sint }, { "uint", value_type::uint }, { "flt", value_type::flt }, { "dbl", value_type::dbl },
+	{ "str", value_type::str }, { "sym", value_type::sym }, { "arr", value_type::arr },
+};
+
+static const std::unordered_map<std::string_view, int32_t> abi_functions = { { "logd", 0 }, { "logi", 1 }, { "logw", 2 }, { "loge", 3 } };
+
+// how an instruction's operand is written (dvar and dfunc's are done by hand)
+enum class operand_kind : uint8_t {
+	value, // type, size, then the bytes
+	symbol, // a variable's or function's number
+	copy_destination, // same, but declares it as a new variable if it's neither yet
+	function, // a function's number, or a variable that has one in it
+	jump, // a label's byte index, as a uint value
+	abi, // an ABI function's number
+	values, // how many values, then each of them
+};
+
+static std::vector<operand_kind> operand_kinds(opcode op) {
+	using enum operand_kind;
+	if (is_conditional_jump(op)) return { jump, value, value };
+	if (is_conversion(op)) return op >= opcode::sym2s ? std::vector{ symbol, symbol } : std::vector{ value, symbol };
+	if (is_arithmetic(op)) {
+		bool remainder = op == opcode::sdiv || op == opcode::udiv || op == opcode::fdiv || op == opcode::ddiv;
+		return remainder ? std::vector{ value, value, symbol, symbol } : std::vector{ value, value, symbol };
+	}
+	switch (op) {
+	case opcode::cvar: return { symbol, copy_destination };
+	case opcode::jmp: return { jump };
+	case opcode::cfunc: return { function, values };
+	case opcode::cabi: return { abi, values };
+	case opcode::garrl: return { symbol, symbol };
+	case opcode::garr: return { symbol, value, symbol };
+	case opcode::sarr: return { symbol, value, value };
+	case opcode::aarr: return { symbol, value };
+	case opcode::iarr: return { symbol, value, value };
+	case opcode::rarr: return { symbol, value };
+	default: return {};
+	}
+}
+
+static const auto instruction_operand_kinds = [] {
+	std::array<std::vector<operand_kind>, instruction_opcode_count> kinds;
+	for (size_t i = 0; i < instruction_opcode_count; i++) kinds[i] = operand_kinds(static_cast<opcode>(i));
+	return kinds;
+}();
+
+static const auto instruction_opcodes = [] {
+	std::unordered_map<std::string_view, opcode> opcodes;
+	for (size_t i = 0; i < instruction_opcode_count; i++) opcodes[opcode_name(static_cast<opcode>(i))] = static_cast<opcode>(i);
+	return opcodes;
+}();
+
+// how many bytes mcasm/mcasm/utils.py says a number needs. (for signed ones that's sometimes one more than it really needs, like 2 for -128, but the bytecode has to match)
+static int unsigned_size(uint64_t v) { return v == 0 ? 1 : (std::bit_width(v) + 7) / 8; }
+static int signed_size(int64_t v) { return v == 0 ? 1 : (std::bit_width((v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v)) * 2) + 7) / 8; }
+
+// big endian, in two's complement if it's negative
+static void write_integer(std::vector<uint8_t>& bytes, uint64_t v, int size) {
+	for (int i = size - 1; i >= 0; i--) bytes.push_back(static_cast<uint8_t>(v >> (i * 8)));
+}
+
+// over 4 bytes that are already there
+static void write_integer_at(std::vector<uint8_t>& bytes, size_t location, uint32_t v) {
+	for (int i = 0; i < 4; i++) bytes[location + i] = static_cast<uint8_t>(v >> ((3 - i) * 8));
+}
+
+// its size, then itself
+static void write_sized_unsigned(std::vector<uint8_t>& bytes, uint64_t v) {
+	bytes.push_back(static_cast<uint8_t>(unsigned_size(v)));
+	write_integer(bytes, v, unsigned_size(v));
+}
+
+static void write_sized_signed(std::vector<uint8_t>& bytes, int64_t v) {
+	bytes.push_back(static_cast<uint8_t>(signed_size(v)));
+	write_integer(bytes, static_cast<uint64_t>(v), signed_size(v));
+}
+
+static int64_t parse_integer(std::string_view text, int64_t min, int64_t max) {
+	std::string_view digits = text.starts_with('+') ? text.substr(1) : text; // (from_chars doesn't take a +)
+	int64_t v;
+	auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), v);
+	if (digits.empty() || error != std::errc() || end != digits.data() + digits.size()) throw std::runtime_error("invalid integer \"" + std::string(text) + "\"");
+	if (v < min || v > max) throw std::runtime_error("integer " + std::string(text) + " is out of range");
+	return v;
+}
+
+static double parse_float(std::string_view text) {
+	std::string s(text);
+	char* end;
+	double v = std::strtod(s.c_str(), &end);
+	if (s.empty() || end != s.c_str() + s.size()) throw std::runtime_error("invalid number \"" + s + "\"");
+	return v;
+}
+
+// splits on every separator, so there can be empty parts
+static std::vector<std::string_view> split(std::string_view text, char separator) {
+	std::vector<std::string_view> parts;
+	for (size_t start = 0;;) {
+		auto end = text.find(separator, start);
+		parts.push_back(text.substr(start, end - start));
+		if (end == std::string_view::npos) return parts;
+		start = end + 1;
+	}
+}
+
+class assembler {
+public:
+	explicit assembler(bool function_values) : function_values(function_values) {}
+
+	std::vector<uint8_t> output;
+
+	void assemble_line(std::string_view line) {
+		// (same as python's strip())
+		auto first = line.find_first_not_of(" \t\r\n\v\f");
+		if (first == std::string_view::npos) return;
+		line = line.substr(first, line.find_last_not_of(" \t\r\n\v\f") - first + 1);
+
+		auto parts = split(line, ' ');
+		auto name = parts[0];
+		if (name.starts_with(';')) return; // (a comment on its own line)
+
+		std::vector<std::string_view> operands;
+		for (size_t i = 1; i < parts.size() && !parts[i].starts_with(';'); i++) operands.push_back(parts[i]);
+		auto operand = [&](size_t i) {
+			if (i >= operands.size()) throw std::runtime_error("missing operand in \"" + std::string(line) + "\"");
+			return operands[i];
+		};
+
+		if (name == "label") {
+			labels[std::string(operand(0))] = output.size();
+			return;
+		}
+		if (name == "endfunc") {
+			if (scopes.size() == 1) throw std::runtime_error("endfunc outside of a function");
+			auto ended = std::move(scopes.back());
+			scopes.pop_back();
+			patch(ended.size_location, ended.size);
+			if (scopes.size() > 1) scopes.back().size += ended.size; // (a function's size includes the ones defined in it)
+			return;
+		}
+
+		auto op = instruction_opcodes.find(name);
+		if (op == instruction_opcodes.end()) throw std::runtime_error("unknown instruction \"" + std::string(name) + "\"");
+		if (scopes.size() > 1) scopes.back().size++;
+		assemble_instruction(op->second, operand);
+	}
+
+	void finish() {
+		if (scopes.size() > 1) throw std::runtime_error("function is missing its endfunc");
+		for (auto& [location, label] : fixups) {
+			auto found = labels.find(label);
+			if (found == labels.end()) throw std::runtime_error("label \"" + label + "\" not defined");
+			patch(location, static_cast<uint32_t>(found->second));
+		}
+	}
+
+private:
+	// names are looked up in the innermost function's scope, which starts off with everything its enclosing scope had
+	struct scope {
+		std::unordered_map<std::string, int32_t> variables, functions;
+		size_t size_location = 0; // where the function's size goes in output
+		uint32_t size = 0; // how many instructions it has so far
+	};
+	bool function_values; // see assemble()
+	std::vector<scope> scopes = { scope{} }; // the top level's first
+	int32_t next_variable = 0, next_function = 0;
+
+	std::unordered_map<std::string, size_t> labels; // where each label is, as of where output is up to (so the last one, if a name's used twice)
+	std::vector<std::pair<size_t, std::string>> fixups; // where jumps to labels that weren't defined yet go, filled in by finish
+
+	std::optional<int32_t> find(const std::unordered_map<std::string, int32_t>& symbols, std::string_view name) {
+		auto found = symbols.find(std::string(name));
+		if (found == symbols.end()) return std::nullopt;
+		return found->second;
+	}
+
+	// variables take priority over functions with the same name
+	std::optional<int32_t> find_symbol(std::string_view name) {
+		auto v = find(scopes.back().variables, name);
+		return v ? v : find(scopes.back().functions, name);
+	}
+
+	int32_t symbol(std::string_view name) {
+		auto s = find_symbol(name);
+		if (!s) throw std::runtime_error("unknown symbol \"" + std::string(name) + "\"");
+		return *s;
+	}
+
+	// same, but with function_values a function (that isn't also a variable) is ~its number, since variables and functions are numbered separately and it'd look like a variable otherwise
+	int32_t value_symbol(std::string_view name) {
+		if (auto v = find(scopes.back().variables, name)) return *v;
+		auto f = find(scopes.back().functions, name);
+		if (f && function_values) return ~*f;
+		if (f) std::cout << "WARNING: function \"" << name << "\" used as a value, which mcvm will read as variable " << *f << " (see assemble's function_values)\n";
+		return symbol(name);
+	}
+
+	// a variable of this name in the current scope, which is a new one unless there already is one
+	int32_t declare_variable(std::string_view name) {
+		auto s = find(scopes.back().variables, name);
+		if (!s) s = next_variable++;
+		scopes.back().variables[std::string(name)] = *s;
+		return *s;
+	}
+
+	void patch(size_t location, uint32_t v) { write_integer_at(output, location, v); }
+
+	// a uint value that isn't known yet, returns where it goes in bytes
+	size_t write_placeholder(std::vector<uint8_t>& bytes) {
+		bytes.insert(bytes.end(), { static_cast<uint8_t>(value_type::uint), 1, 4 });
+		bytes.insert(bytes.end(), 4, 0);
+		return bytes.size() - 4;
+	}
+
+	void write_value(std::vector<uint8_t>& bytes, std::string_view text) {
+		auto colon = text.find(':');
+		auto type_name = text.substr(0, colon);
+		auto value = colon == std::string_view::npos ? std::string_view() : text.substr(colon + 1);
+		auto type_entry = value_types.find(type_name);
+		if (type_entry == value_types.end()) throw std::runtime_error("unknown value type \"" + std::string(type_name) + "\"");
+		auto type = type_entry->second;
+
+		std::vector<uint8_t> data;
+		auto s = find_symbol(value);
+		if (type == value_type::sym || s) {
+			if (type != value_type::sym) {
+				std::cout << "WARNING: symbol value \"" << value << "\" passed with non-symbol type, casting it to symbol...\n";
+				type = value_type::sym;
+			}
+			write_integer(data, static_cast<uint32_t>(value_symbol(value)), 4);
+		}
+		else if (value == "null") {
+			data.push_back(0);
+		}
+		else {
+			for (auto part : split(value, ',')) {
+				switch (type) {
+				case value_type::sint:
+					write_integer(data, static_cast<uint64_t>(parse_integer(part, INT32_MIN, INT32_MAX)), 4);
+					break;
+				case value_type::uint:
+					write_integer(data, static_cast<uint64_t>(parse_integer(part, 0, UINT32_MAX)), 4);
+					break;
+				case value_type::flt: {
+					double d = parse_float(part);
+					float f = static_cast<float>(d);
+					if (std::isinf(f) && !std::isinf(d)) throw std::runtime_error("float " + std::string(part) + " is too large");
+					write_integer(data, std::bit_cast<uint32_t>(f), 4);
+					break;
+				}
+				case value_type::dbl:
+					write_integer(data, std::bit_cast<uint64_t>(parse_float(part)), 8);
+					break;
+				case value_type::str:
+					data.push_back(static_cast<uint8_t>(parse_integer(part, 0, 255)));
+					break;
+				case value_type::arr:
+					write_values(data, part);
+					break;
+				case value_type::sym:
+					break; // (handled above)
+				}
+			}
+		}
+
+		bytes.push_back(static_cast<uint8_t>(type));
+		write_sized_unsigned(bytes, data.size());
+		bytes.insert(bytes.end(), data.begin(), data.end());
+	}
+
+	// "sym:v3/sint:1", or "null" for none
+	void write_values(std::vector<uint8_t>& bytes, std::string_view text) {
+		auto values = text == "null" ? std::vector<std::string_view>() : split(text, '/');
+		write_sized_unsigned(bytes, values.size());
+		for (auto value : values) write_value(bytes, value);
+	}
+
+	template <typename F>
+	void assemble_instruction(opcode op, F&& operand) {
+		std::vector<uint8_t> bytes; // the operands
+		// where in them the jump to a label that isn't defined yet (or dfunc's size) goes. they can only be fixed up once the header's in front of them.
+		std::optional<std::pair<size_t, std::string>> pending_jump;
+		std::optional<size_t> pending_size;
+
+		if (op == opcode::dvar) {
+			write_sized_signed(bytes, declare_variable(operand(0))); // (before the value, which can be the variable itself)
+			write_value(bytes, operand(1));
+		}
+		else if (op == opcode::dfunc) {
+			auto name = std::string(operand(0));
+			auto f = find(scopes.back().functions, name);
+			if (!f) f = next_function++;
+			scopes.back().functions[name] = *f; // (before its scope is made, so it can call itself)
+			write_sized_signed(bytes, *f);
+			pending_size = write_placeholder(bytes); // (filled in at endfunc)
+
+			scope function_scope = { scopes.back().variables, scopes.back().functions };
+			auto parameters = operand(1) == "null" ? std::vector<std::string_view>() : split(operand(1), '/');
+			write_sized_unsigned(bytes, parameters.size());
+			for (auto parameter : parameters) {
+				// "v3:sym". parameters are always new variables
+				auto fields = split(parameter, ':');
+				if (fields.size() < 2 || !value_types.contains(fields[1])) throw std::runtime_error("invalid parameter \"" + std::string(parameter) + "\"");
+				auto v = next_variable++;
+				function_scope.variables[std::string(fields[0])] = v;
+				write_sized_signed(bytes, v);
+				bytes.push_back(static_cast<uint8_t>(value_types.at(fields[1])));
+			}
+			scopes.push_back(std::move(function_scope));
+		}
+		else {
+			auto& kinds = instruction_operand_kinds[static_cast<size_t>(op)];
+			for (size_t i = 0; i < kinds.size(); i++) {
+				auto text = operand(i);
+				switch (kinds[i]) {
+				case operand_kind::value:
+					write_value(bytes, text);
+					break;
+				case operand_kind::symbol:
+					write_sized_signed(bytes, value_symbol(text));
+					break;
+				case operand_kind::copy_destination:
+					write_sized_signed(bytes, find_symbol(text) ? symbol(text) : declare_variable(text));
+					break;
+				case operand_kind::function: {
+					// (with function_values, a variable holding a function is ~its number, the other way around to values)
+					auto f = find(scopes.back().functions, text);
+					if (!f && function_values) {
+						if (auto v = find(scopes.back().variables, text)) f = ~*v;
+					}
+					if (!f) throw std::runtime_error("unknown function \"" + std::string(text) + "\"");
+					write_sized_signed(bytes, *f);
+					break;
+				}
+				case operand_kind::jump: {
+					auto location = write_placeholder(bytes);
+					auto label = labels.find(std::string(text));
+					if (label != labels.end()) write_integer_at(bytes, location, static_cast<uint32_t>(label->second)); // (a jump back up, it's known already)
+					else pending_jump = { location, std::string(text) };
+					break;
+				}
+				case operand_kind::abi: {
+					auto a = abi_functions.find(text);
+					if (a == abi_functions.end()) throw std::runtime_error("unknown ABI function \"" + std::string(text) + "\"");
+					write_sized_signed(bytes, a->second);
+					break;
+				}
+				case operand_kind::values:
+					write_values(bytes, text);
+					break;
+				}
+			}
+		}
+
+		// the header: the opcode, then how many bytes the operands are
+		output.push_back(static_cast<uint8_t>(op));
+		write_sized_unsigned(output, bytes.size());
+		size_t start = output.size();
+		output.insert(output.end(), bytes.begin(), bytes.end());
+
+		if (pending_jump) fixups.emplace_back(start + pending_jump->first, std::move(pending_jump->second));
+		if (pending_size) scopes.back().size_location = start + *pending_size;
+	}
+};
+
+std::vector<uint8_t> assemble(std::string_view text, bool function_values) {
+	assembler a(function_values);
+	for (auto line : split(text, '\n')) a.assemble_line(line);
+	a.finish();
+	return std::move(a.output);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// the MCASM assembler (a port of mcasm/main.py, which gives the exact same bytes for the same text), so compiling doesn't have to start up python.
+// it goes through the text once: jumps to labels that haven't been seen yet, and dfunc's size, are left as 0 and filled in once they're known (they're always 4 bytes, so nothing moves).
+// one thing it takes that mcasm/main.py doesn't: "cvar x y" when y isn't a variable yet declares it, like dvar would. (codegen copies into new variables that way, see copy())
+
+// throws std::runtime_error if the text isn't valid MCASM.
+// function_values changes the format, so that mcvm can run programs that use functions as values (which mcasm/main.py doesn't have a way to write yet).
+// functions and variables are numbered separately, so a function used as a value ("sym:f", "cvar f x") is written as ~its number, and "cfunc x" where x is a variable holding a function is written as ~x.
+// without it, the bytes are the same as mcasm/main.py's: a function used as a value is its plain number (with a warning, since mcvm reads that as a variable), and "cfunc x" only takes functions.
+std::vector<uint8_t> assemble(std::string_view text, bool function_values = false);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "interner.h"
+
+// the parser turns the whole script into a tree of these (allocated in parser_context::nodes) before any MCASM is generated.
+// expressions are operands (see main.cpp), statements are below. nodes point at each other with plain pointers, the arena owns all of them.
+
+struct _type_info;
+using type_info_ = _type_info*; // types live as long as the compilation (see type_storage in main.cpp), so they're never freed on their own
+
+class expression;
+class function_literal;
+
+enum class statement_kind {
+	expression, // an expression on its own, like a call or an assignment
+	variable_declaration,
+	return_,
+	while_,
+	for_,
+	if_,
+	class_declaration,
+};
+
+struct statement {
+	statement_kind kind;
+	int line = -1;
+
+	// function literals that appear in this statement. their definitions (dfunc) are emitted right before the statement, so they exist by the time it runs.
+	std::vector<function_literal*> functions;
+
+	statement(statement_kind k, int l) : kind(k), line(l) {}
+};
+
+struct block {
+	std::vector<statement*> statements;
+};
+
+struct expression_statement : statement {
+	expression* value;
+
+	expression_statement(int l, expression* v) : statement(statement_kind::expression, l), value(v) {}
+};
+
+struct variable_declaration : statement {
+	type_info_ type; // of the variable, not necessarily of value
+	std::string var_name;
+	symbol_id asm_name;
+	expression* value;
+
+	variable_declaration(int l, type_info_ t, std::string name, symbol_id asm_name, expression* v) :
+		statement(statement_kind::variable_declaration, l), type(t), var_name(name), asm_name(asm_name), value(v) {}
+};
+
+struct return_statement : statement {
+	function_literal* function; // the function being returned from
+	expression* value; // nullptr for void functions
+
+	return_statement(int l, function_literal* f, expression* v) : statement(statement_kind::return_, l), function(f), value(v) {}
+};
+
+struct while_statement : statement {
+	expression* condition;
+	block body;
+
+	while_statement(int l, expression* c) : statement(statement_kind::while_, l), condition(c) {}
+};
+
+struct for_statement : statement {
+	statement* initial = nullptr; // variable_declaration or expression_statement, may be nullptr
+	expression* condition = nullptr; // may be nullptr, which loops forever
+	expression* increment = nullptr; // may be nullptr
+	block body;
+
+	for_statement(int l) : statement(statement_kind::for_, l) {}
+};
+
+struct if_statement : statement {
+	// the if and then each elseif, in order
+	struct branch {
+		expression* condition;
+		block* body;
+	};
+	std::vector<branch> branches;
+	block* else_body = nullptr; // nullptr if there's no else
+
+	if_statement(int l) : statement(statement_kind::if_, l) {}
+};
+
+struct class_declaration : statement {
+	type_info_ type;
+
+	class_declaration(int l, type_info_ t) : statement(statement_kind::class_declaration, l), type(t) {}
+};
@@ -0,0 +1,18 @@
+#include "interner.h"
+
+symbol_id string_interner::intern(std::string_view name) {
+	auto it = ids.find(name);
+	if (it != ids.end()) return it->second;
+
+	// own a copy, the name might be a temporary or a view into a script that gets unmapped
+	std::string_view stored = storage.emplace_back(name);
+	symbol_id id = static_cast<symbol_id>(names.size());
+	names.push_back(stored);
+	ids.emplace(stored, id);
+	return id;
+}
+
+symbol_id string_interner::find(std::string_view name) const {
+	auto it = ids.find(name);
+	return it == ids.end() ? no_symbol : it->second;
+}
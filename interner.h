@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// dense ID of an interned name. two names are the same iff their IDs are.
+using symbol_id = uint32_t;
+
+// what non-identifier tokens have as their symbol. never returned by intern().
+constexpr symbol_id no_symbol = UINT32_MAX;
+
+// hands out symbol IDs for names, so the symbol and type tables only ever hash a name once (when it's lexed), and after that just compare integers.
+class string_interner {
+public:
+	// returns the ID of the given name, giving it a new one if it doesn't have one yet
+	symbol_id intern(std::string_view name);
+
+	// no_symbol if the name was never interned
+	symbol_id find(std::string_view name) const;
+
+	std::string_view name(symbol_id id) const { return names[id]; }
+
+	size_t size() const { return names.size(); }
+
+private:
+	std::deque<std::string> storage; // deque so the views in names and ids stay valid as it grows
+	std::vector<std::string_view> names; // indexed by ID
+	std::unordered_map<std::string_view, symbol_id> ids;
+};
+
+// defined in main.cpp, before anything that interns names during static initialization
+extern string_interner interner;
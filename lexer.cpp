@@ -0,0 +1,471 @@
+#include "lexer.h"
+#include "simd_scan.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace {
+
+	// every byte of the script falls into one of these. characters only get their own class if some state of the DFA treats them differently from the rest
+	enum char_class : uint8_t {
+		cc_other, // not valid outside of strings and comments
+		cc_space,
+		cc_newline,
+		cc_letter,
+		cc_letter_e, // also an exponent, or a hex digit
+		cc_letter_x, // also what makes a number hex
+		cc_hex_letter, // the other letters that are hex digits
+		cc_zero, // also what a hex number starts with
+		cc_digit,
+		cc_quote,
+		cc_backslash,
+		cc_dot,
+		cc_star,
+		cc_slash,
+		cc_percent,
+		cc_plus,
+		cc_minus,
+		cc_less,
+		cc_greater,
+		cc_equals,
+		cc_bang,
+		cc_ampersand,
+		cc_pipe,
+		cc_punctuation, // always a token on its own
+
+		CHAR_CLASS_COUNT
+	};
+
+	constexpr std::array<char_class, 256> CHAR_CLASSES = []() {
+		std::array<char_class, 256> classes = {};
+		for (auto& c : classes) c = cc_other;
+
+		for (int c = 'a'; c <= 'z'; c++) classes[c] = cc_letter;
+		for (int c = 'A'; c <= 'Z'; c++) classes[c] = cc_letter;
+		for (char c : std::string_view("abcdfABCDF")) classes[(uint8_t)c] = cc_hex_letter;
+		classes['e'] = classes['E'] = cc_letter_e;
+		classes['x'] = classes['X'] = cc_letter_x;
+		classes['_'] = cc_letter;
+		classes['0'] = cc_zero;
+		for (int c = '1'; c <= '9'; c++) classes[c] = cc_digit;
+
+		classes[' '] = cc_space;
+		classes['\t'] = cc_space;
+		classes['\r'] = cc_space;
+		classes['\v'] = cc_space;
+		classes['\f'] = cc_space;
+		classes['\n'] = cc_newline;
+
+		classes['"'] = cc_quote;
+		classes['\\'] = cc_backslash;
+		classes['.'] = cc_dot;
+		classes['*'] = cc_star;
+		classes['/'] = cc_slash;
+		classes['%'] = cc_percent;
+		classes['+'] = cc_plus;
+		classes['-'] = cc_minus;
+		classes['<'] = cc_less;
+		classes['>'] = cc_greater;
+		classes['='] = cc_equals;
+		classes['!'] = cc_bang;
+		classes['&'] = cc_ampersand;
+		classes['|'] = cc_pipe;
+		for (char c : std::string_view("()[]{};:,")) classes[(uint8_t)c] = cc_punctuation;
+
+		return classes;
+	}();
+
+	constexpr std::array<token_kind, 256> PUNCTUATION_KINDS = []() {
+		std::array<token_kind, 256> kinds = {};
+		for (auto& k : kinds) k = token_kind::end;
+		kinds['('] = token_kind::left_paren;
+		kinds[')'] = token_kind::right_paren;
+		kinds['['] = token_kind::left_bracket;
+		kinds[']'] = token_kind::right_bracket;
+		kinds['{'] = token_kind::left_brace;
+		kinds['}'] = token_kind::right_brace;
+		kinds[';'] = token_kind::semicolon;
+		kinds[':'] = token_kind::colon;
+		kinds[','] = token_kind::comma;
+		return kinds;
+	}();
+
+	// states of the DFA that finds where identifiers, numbers and operators end. a token is as long as the DFA can keep going, and what it is depends on the state it stops in.
+	// strings, comments and whitespace don't go through the DFA, they're scanned in bulk (see simd_scan.h), and punctuation is always one character.
+	enum lexer_state : uint8_t {
+		ls_start,
+		ls_identifier,
+
+		// numbers, [-] (0x hexdigits | [digits] [. [digits]] [(e|E) [+|-] digits]), with at least one digit before the exponent
+		ls_negative, // a "-" that's the sign of a literal
+		ls_zero, // which might be followed by x
+		ls_integer,
+		ls_hex_mark, // "0x"
+		ls_hex,
+		ls_fraction, // after the "."
+		ls_exponent_mark, // the "e"
+		ls_exponent_sign,
+		ls_exponent,
+
+		// operators
+		ls_dot, // member access, unless it's the start of a number like .5
+		ls_operator, // * / % < > = !, which can all be followed by =
+		ls_plus, // + += ++
+		ls_minus, // - -= --
+		ls_ampersand, // has to be part of &&, &== or &!=
+		ls_ampersand_equals,
+		ls_ampersand_bang,
+		ls_pipe, // has to be part of ||
+		ls_operator_end, // a whole operator, nothing can be added to it
+
+		LEXER_STATE_COUNT,
+
+		// not a real state, says the token ended before this character
+		ls_emit,
+	};
+
+	constexpr std::array<std::array<lexer_state, CHAR_CLASS_COUNT>, LEXER_STATE_COUNT> TRANSITIONS = []() {
+		std::array<std::array<lexer_state, CHAR_CLASS_COUNT>, LEXER_STATE_COUNT> table = {};
+		for (auto& row : table)
+			for (auto& next : row)
+				next = ls_emit;
+
+		auto on = [&](lexer_state from, std::initializer_list<char_class> classes, lexer_state to) {
+			for (auto c : classes) table[from][c] = to;
+		};
+		std::initializer_list<char_class> letters = { cc_letter, cc_letter_e, cc_letter_x, cc_hex_letter };
+		std::initializer_list<char_class> digits = { cc_zero, cc_digit };
+		std::initializer_list<char_class> hex_digits = { cc_zero, cc_digit, cc_letter_e, cc_hex_letter };
+
+		on(ls_start, letters, ls_identifier);
+		on(ls_identifier, letters, ls_identifier);
+		on(ls_identifier, digits, ls_identifier);
+
+		on(ls_start, { cc_zero }, ls_zero);
+		on(ls_start, { cc_digit }, ls_integer);
+		on(ls_negative, { cc_zero }, ls_zero);
+		on(ls_negative, { cc_digit }, ls_integer);
+		on(ls_zero, { cc_letter_x }, ls_hex_mark);
+		for (auto state : { ls_zero, ls_integer }) {
+			on(state, digits, ls_integer);
+			on(state, { cc_dot }, ls_fraction);
+			on(state, { cc_letter_e }, ls_exponent_mark);
+		}
+		on(ls_hex_mark, hex_digits, ls_hex);
+		on(ls_hex, hex_digits, ls_hex);
+		on(ls_dot, digits, ls_fraction);
+		on(ls_fraction, digits, ls_fraction);
+		on(ls_fraction, { cc_letter_e }, ls_exponent_mark);
+		on(ls_exponent_mark, { cc_plus, cc_minus }, ls_exponent_sign);
+		on(ls_exponent_mark, digits, ls_exponent);
+		on(ls_exponent_sign, digits, ls_exponent);
+		on(ls_exponent, digits, ls_exponent);
+
+		on(ls_start, { cc_dot }, ls_dot);
+		on(ls_start, { cc_star, cc_slash, cc_percent, cc_less, cc_greater, cc_equals, cc_bang }, ls_operator);
+		on(ls_start, { cc_plus }, ls_plus);
+		on(ls_start, { cc_minus }, ls_minus);
+		on(ls_start, { cc_ampersand }, ls_ampersand);
+		on(ls_start, { cc_pipe }, ls_pipe);
+		on(ls_operator, { cc_equals }, ls_operator_end);
+		on(ls_plus, { cc_plus, cc_equals }, ls_operator_end);
+		on(ls_minus, { cc_minus, cc_equals }, ls_operator_end);
+		on(ls_ampersand, { cc_ampersand }, ls_operator_end);
+		on(ls_ampersand, { cc_equals }, ls_ampersand_equals);
+		on(ls_ampersand, { cc_bang }, ls_ampersand_bang);
+		on(ls_ampersand_equals, { cc_equals }, ls_operator_end);
+		on(ls_ampersand_bang, { cc_equals }, ls_operator_end);
+		on(ls_pipe, { cc_pipe }, ls_operator_end);
+
+		return table;
+	}();
+
+	// keywords, word-like literals and operators, found with a perfect hash
+	struct reserved_word {
+		std::string_view text;
+		token_kind kind = token_kind::end;
+		operator_id op = operator_id::none;
+	};
+
+	constexpr reserved_word RESERVED_WORDS[] = {
+		{"class", token_kind::keyword_class},
+		{"function", token_kind::keyword_function},
+		{"for", token_kind::keyword_for},
+		{"while", token_kind::keyword_while},
+		{"if", token_kind::keyword_if},
+		{"else", token_kind::keyword_else},
+		{"elseif", token_kind::keyword_elseif},
+		{"return", token_kind::keyword_return},
+		{"var", token_kind::keyword_var},
+		{"true", token_kind::bool_literal},
+		{"false", token_kind::bool_literal},
+		{"null", token_kind::null_literal},
+
+		{".", token_kind::operator_, operator_id::member_access},
+		{"*", token_kind::operator_, operator_id::multiply},
+		{"/", token_kind::operator_, operator_id::divide},
+		{"%", token_kind::operator_, operator_id::modulo},
+		{"+", token_kind::operator_, operator_id::add},
+		{"-", token_kind::operator_, operator_id::subtract},
+		{">=", token_kind::operator_, operator_id::greater_equal},
+		{"<=", token_kind::operator_, operator_id::less_equal},
+		{"<", token_kind::operator_, operator_id::less},
+		{">", token_kind::operator_, operator_id::greater},
+		{"==", token_kind::operator_, operator_id::equal},
+		{"!=", token_kind::operator_, operator_id::not_equal},
+		{"&==", token_kind::operator_, operator_id::reference_equal},
+		{"&!=", token_kind::operator_, operator_id::reference_not_equal},
+		{"&&", token_kind::operator_, operator_id::logical_and},
+		{"||", token_kind::operator_, operator_id::logical_or},
+		{"!", token_kind::operator_, operator_id::logical_not},
+		{"=", token_kind::operator_, operator_id::assign},
+		{"+=", token_kind::operator_, operator_id::add_assign},
+		{"-=", token_kind::operator_, operator_id::subtract_assign},
+		{"*=", token_kind::operator_, operator_id::multiply_assign},
+		{"/=", token_kind::operator_, operator_id::divide_assign},
+		{"%=", token_kind::operator_, operator_id::modulo_assign},
+		{"++", token_kind::operator_, operator_id::increment},
+		{"--", token_kind::operator_, operator_id::decrement},
+	};
+
+	constexpr size_t RESERVED_WORD_SLOTS = 128;
+
+	// constants were brute-forced so that no two reserved words collide (checked below)
+	constexpr size_t reserved_word_hash(std::string_view s) {
+		return (((uint8_t)s.front() * 2u) ^ ((uint8_t)s.back() * 13u) ^ (uint8_t)s[s.size() / 2] ^ s.size()) % RESERVED_WORD_SLOTS;
+	}
+
+	struct reserved_word_table {
+		std::array<reserved_word, RESERVED_WORD_SLOTS> slots = {};
+		bool has_collision = false;
+	};
+
+	constexpr reserved_word_table RESERVED_WORD_TABLE = []() {
+		reserved_word_table table;
+		for (auto& word : RESERVED_WORDS) {
+			auto& slot = table.slots[reserved_word_hash(word.text)];
+			if (!slot.text.empty()) table.has_collision = true;
+			slot = word;
+		}
+		return table;
+	}();
+	static_assert(!RESERVED_WORD_TABLE.has_collision, "reserved words collide in the perfect hash, pick new constants for reserved_word_hash");
+
+	// returns nullptr if s isn't a keyword/operator
+	const reserved_word* find_reserved_word(std::string_view s) {
+		const reserved_word& slot = RESERVED_WORD_TABLE.slots[reserved_word_hash(s)];
+		return slot.text == s ? &slot : nullptr;
+	}
+
+	// whether a "-" after a token of this kind has to be subtraction
+	bool ends_operand(token_kind kind) {
+		return kind == token_kind::identifier
+			|| (kind >= token_kind::integer_literal && kind <= token_kind::null_literal)
+			|| kind == token_kind::right_paren
+			|| kind == token_kind::right_bracket;
+	}
+
+	char_class class_of(char c) {
+		return CHAR_CLASSES[(uint8_t)c];
+	}
+}
+
+void tokenizer_context::skip_trivia() {
+	const char* p = src.data() + cursor;
+	const char* end = src.data() + src.size();
+	while (true) {
+		p = skip_whitespace(p, end, lexer_line_number);
+		if (end - p < 2 || p[0] != '/') break;
+
+		if (p[1] == '/') {
+			p = find_line_end(p + 2, end);
+		}
+		else if (p[1] == '*') {
+			p = find_block_comment_end(p + 2, end, lexer_line_number);
+			if (p == nullptr) throw std::runtime_error("unterminated block comment");
+		}
+		else break;
+	}
+	cursor = p - src.data();
+}
+
+token tokenizer_context::lex_token() {
+	skip_trivia();
+
+	token t;
+	t.line = lexer_line_number;
+
+	if (cursor >= src.size()) {
+		t.text = src.substr(src.size());
+		return t;
+	}
+
+	size_t start = cursor;
+	char_class first = class_of(src[cursor]);
+	char_class second = cursor + 1 < src.size() ? class_of(src[cursor + 1]) : cc_other;
+
+	lexer_state state;
+	switch (first) {
+	case cc_punctuation:
+		cursor++;
+		t.kind = PUNCTUATION_KINDS[(uint8_t)src[start]];
+		t.text = src.substr(start, 1);
+		last_significant_kind = t.kind;
+		return t;
+	case cc_quote:
+		{
+			const char* closing_quote = find_string_end(src.data() + start + 1, src.data() + src.size(), lexer_line_number);
+			if (closing_quote == nullptr) throw std::runtime_error("unterminated string literal");
+			cursor = closing_quote + 1 - src.data();
+			t.kind = token_kind::string_literal;
+			t.text = src.substr(start, cursor - start);
+			last_significant_kind = t.kind;
+			return t;
+		}
+	case cc_minus:
+		if ((second == cc_digit || second == cc_zero) && !ends_operand(last_significant_kind)) state = ls_negative; // sign of a literal
+		else state = ls_minus;
+		break;
+	case cc_dot:
+		// right after an operand it's member access, even before a digit
+		state = ends_operand(last_significant_kind) ? ls_operator_end : ls_dot;
+		break;
+	default:
+		state = TRANSITIONS[ls_start][first];
+		if (state == ls_emit) throw std::runtime_error("unexpected character \"" + std::string(src.substr(start, 1)) + "\"");
+	}
+
+	// run the DFA until the token ends
+	cursor++;
+	while (cursor < src.size()) {
+		lexer_state next = TRANSITIONS[state][class_of(src[cursor])];
+		if (next == ls_emit) break;
+		cursor++;
+		state = next;
+	}
+
+	t.text = src.substr(start, cursor - start);
+	switch (state) {
+	case ls_identifier:
+		t.kind = token_kind::identifier;
+		// a reference type like "A&" is one token, unless the & starts &&, &== or &!=
+		if (cursor < src.size() && src[cursor] == '&' && !(cursor + 1 < src.size() && (src[cursor + 1] == '&' || src[cursor + 1] == '=' || src[cursor + 1] == '!'))) {
+			cursor++;
+			t.text = src.substr(start, cursor - start);
+		}
+		else if (auto word = find_reserved_word(t.text)) {
+			t.kind = word->kind;
+			if (t.kind == token_kind::bool_literal) t.int_value = t.text == "true";
+		}
+		if (t.kind == token_kind::identifier) t.symbol = interner.intern(t.text);
+		break;
+	case ls_zero:
+	case ls_integer:
+	case ls_hex:
+	case ls_fraction:
+	case ls_exponent:
+		finish_number(t, start, state == ls_fraction || state == ls_exponent, state == ls_hex);
+		break;
+	case ls_negative:
+	case ls_hex_mark:
+	case ls_exponent_mark:
+	case ls_exponent_sign:
+		throw std::runtime_error("malformed number");
+	case ls_ampersand:
+	case ls_ampersand_equals:
+	case ls_ampersand_bang:
+	case ls_pipe:
+		throw std::runtime_error("unrecognized operator \"" + std::string(src.substr(start, 1)) + "\"");
+	default:
+		{
+			// every state an operator can end in spells a reserved word
+			auto word = find_reserved_word(t.text);
+			assert(word != nullptr && word->kind == token_kind::operator_);
+			t.kind = token_kind::operator_;
+			t.op = word->op;
+			break;
+		}
+	}
+
+	last_significant_kind = t.kind;
+	return t;
+}
+
+// [-] (0x hexdigits | [digits] [. [digits]] [(e|E) [+|-] digits]) [i32|f64]
+// the suffix forces the type, so 3f64 is an f64. hex literals can't be f64, the f would just be another hex digit.
+void tokenizer_context::finish_number(token& t, size_t start, bool is_float, bool hex) {
+	auto at = [this](size_t i) { return i < src.size() ? src[i] : '\0'; };
+
+	bool negative = src[start] == '-';
+	size_t digits_start = start + negative + (hex ? 2 : 0);
+	size_t digits_end = cursor;
+
+	if (src.substr(cursor, 3) == "i32") {
+		if (is_float) throw std::runtime_error("float literal can't have an i32 suffix");
+		cursor += 3;
+	}
+	else if (src.substr(cursor, 3) == "f64") {
+		is_float = true;
+		cursor += 3;
+	}
+
+	// anything else stuck to the number, like 3abc or 1.2.3
+	char_class after = class_of(at(cursor));
+	if (TRANSITIONS[ls_identifier][after] == ls_identifier || after == cc_dot) throw std::runtime_error("malformed number");
+
+	t.text = src.substr(start, cursor - start);
+	const char* first = src.data() + digits_start;
+	const char* last = src.data() + digits_end;
+	if (is_float) {
+		t.kind = token_kind::float_literal;
+		// from_chars takes the "-" itself
+		auto [end, error] = std::from_chars(src.data() + start, last, t.float_value);
+		if (error != std::errc() || end != last) throw std::runtime_error("malformed number " + std::string(t.text));
+	}
+	else {
+		t.kind = token_kind::integer_literal;
+		uint64_t magnitude = 0;
+		auto [end, error] = std::from_chars(first, last, magnitude, hex ? 16 : 10);
+		if (error == std::errc::result_out_of_range || magnitude > (negative ? 2147483648ull : 2147483647ull))
+			throw std::runtime_error("integer literal " + std::string(t.text) + " doesn't fit in an i32");
+		if (error != std::errc() || end != last) throw std::runtime_error("malformed number " + std::string(t.text));
+		t.int_value = static_cast<int32_t>(negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude));
+	}
+}
+
+void tokenizer_context::lex_next() {
+	// the slot being overwritten has to be a token that was already handed out, far enough back that it can't be stepped back to anymore
+	assert(lexed - handed_out < LOOKAHEAD);
+	ring[lexed % LOOKAHEAD] = lex_token();
+	lexed++;
+}
+
+token tokenizer_context::next_token() {
+	if (handed_out == lexed) lex_next();
+	const token& t = ring[handed_out % LOOKAHEAD];
+	handed_out++;
+	current_line_number = t.line;
+	return t;
+}
+
+const token& tokenizer_context::peek(size_t k) {
+	assert(k < LOOKAHEAD);
+	while (lexed <= handed_out + k) lex_next();
+	return ring[(handed_out + k) % LOOKAHEAD];
+}
+
+void tokenizer_context::unget() {
+	assert(handed_out > 0);
+	assert(lexed - handed_out < LOOKAHEAD); // otherwise the token was already overwritten
+	handed_out--;
+	current_line_number = ring[handed_out % LOOKAHEAD].line;
+}
+
+std::string describe(const token& t) {
+	if (t.kind == token_kind::end) return "<eof>";
+	return "\"" + std::string(t.text) + "\"";
+}
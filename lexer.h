@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "interner.h"
+
+enum class token_kind : uint8_t {
+	end, // <eof>
+
+	identifier, // names of variables and types, including reference types like "A&"
+	integer_literal, // decimal or 0x hex, maybe with an i32 suffix
+	float_literal, // has a fraction, an exponent or an f64 suffix
+	string_literal, // still has its quotes and escapes
+	bool_literal,
+	null_literal,
+
+	operator_, // which one is in token::op
+
+	left_paren,
+	right_paren,
+	left_bracket,
+	right_bracket,
+	left_brace,
+	right_brace,
+	semicolon,
+	colon,
+	comma,
+
+	keyword_class,
+	keyword_function,
+	keyword_for,
+	keyword_while,
+	keyword_if,
+	keyword_else,
+	keyword_elseif,
+	keyword_return,
+	keyword_var,
+};
+
+enum class operator_id : uint8_t {
+	member_access, // .
+
+	multiply,
+	divide,
+	modulo,
+	add,
+	subtract,
+
+	greater_equal,
+	less_equal,
+	less,
+	greater,
+	equal,
+	not_equal,
+	reference_equal, // &==
+	reference_not_equal, // &!=
+
+	logical_and,
+	logical_or,
+	logical_not,
+
+	assign,
+	add_assign,
+	subtract_assign,
+	multiply_assign,
+	divide_assign,
+	modulo_assign,
+
+	increment,
+	decrement,
+
+	none
+};
+
+struct token {
+	token_kind kind = token_kind::end;
+	operator_id op = operator_id::none;
+	std::string_view text; // view into the script, empty at <eof>
+	symbol_id symbol = no_symbol; // interned text of identifiers, no_symbol for everything else
+	int line = 1; // where the token starts
+
+	// parsed value of integer and bool literals (bools are 0 or 1), so nothing after the lexer has to look at the digits again
+	int32_t int_value = 0;
+	// parsed value of float literals
+	double float_value = 0.0;
+
+	bool is(token_kind k) const { return kind == k; }
+	bool is(operator_id o) const { return kind == token_kind::operator_ && op == o; }
+	bool is_literal() const { return kind >= token_kind::integer_literal && kind <= token_kind::null_literal; }
+	bool is_keyword() const { return kind >= token_kind::keyword_class; }
+};
+
+// lexer?
+// tokens are lexed into a small ring buffer, so the parser can look ahead and step back without anything being lexed twice.
+struct tokenizer_context {
+	// how many tokens can be looked ahead at (or stepped back over) at once
+	static constexpr size_t LOOKAHEAD = 8;
+
+	int current_line_number = 1; // line of the last token handed out, for error messages
+
+	std::string_view src; // the whole script, usually a view of a source_file's mapping
+	size_t cursor = 0; // index in src of the next character to be lexed (may be a few tokens past what's been handed out)
+
+	// true if the next token is <eof>
+	bool at_end() { return peek().is(token_kind::end); }
+
+	// returns the next token in the script (token_kind::end at <eof>), skipping whitespace and comments. throws on malformed input.
+	token next_token();
+
+	// the token k places after the last one handed out, without handing it out. peek(0) is what next_token() will return. k < LOOKAHEAD.
+	const token& peek(size_t k = 0);
+
+	// steps back one token, so next_token() hands out the last token again. can step back at most LOOKAHEAD tokens (minus however many are peeked ahead).
+	void unget();
+
+private:
+	std::array<token, LOOKAHEAD> ring; // token number i lives in ring[i % LOOKAHEAD]
+	size_t lexed = 0; // number of tokens lexed so far
+	size_t handed_out = 0; // number of tokens handed out so far (minus the ones stepped back over)
+
+	int lexer_line_number = 1; // line of cursor
+
+	// decides whether a "-" directly before a digit is a minus operator or the sign of a literal
+	token_kind last_significant_kind = token_kind::end;
+
+	// lexes one more token into the ring
+	void lex_next();
+
+	// lexes the token at the cursor
+	token lex_token();
+
+	// finishes the number literal the DFA scanned from start to the cursor: takes its suffix, checks that it's well formed and fits its type, and parses it into t
+	void finish_number(token& t, size_t start, bool is_float, bool hex);
+
+	// moves the cursor past whitespace and comments, counting the lines they span
+	void skip_trivia();
+};
+
+// for error messages, like "\"(\"" or "<eof>"
+std::string describe(const token& t);
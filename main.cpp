@@ -1,16 +1,37 @@
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
-#include <regex>
+#include <charconv>
+#include <memory>
 #include <variant>
 #include <optional>
+#include <string_view>
 
-std::string get_next_assembly_name();
-std::string copy(std::string, std::string);
+#include "arena.h"
+#include "assembler.h"
+#include "ast.h"
+#include "interner.h"
+#include "lexer.h"
+#include "mcasm.h"
+#include "mcvm.h"
+#include "optimizer.h"
+#include "source_file.h"
+#include "symbol_table.h"
+
+symbol_id get_next_assembly_name(std::string_view suffix = "");
+void copy(symbol_id, mcasm_operand);
+
+mcasm_program out; // everything generated so far
 
 const std::string COMPILER_TEMP_NAME = "COMPILER_TEMPORARY";
 
@@ -18,25 +39,41 @@ class operand;
 class varname;
 class expression;
 
-struct _type_info;
-using type_info_ = std::shared_ptr<_type_info>;
+static void branch_if(operand& condition, bool value, symbol_id label);
 
 struct type_field {
 	type_info_ type;
-	std::shared_ptr<operand> default_value;
+	operand* default_value;
 	int index = -1;
 };
 
+enum class type_kind {
+	basic, // builtins, including void and null
+	class_,
+	function
+};
+
+// there's only ever one _type_info per type (function types are hash-consed, see function_type()), so types can be compared by pointer
 struct _type_info {
 	bool pass_by_reference = true;
 
 	std::string name;
+	symbol_id id; // interned name
 
 	bool array;
 
 	std::unordered_map<std::string, type_field> fields = {};
 
-	_type_info(bool b, std::string n, decltype(fields) f, bool arr): pass_by_reference(b), name(n), array(arr), fields(f) {
+	type_kind kind = type_kind::basic;
+
+	// the reference type of a value type, or the value type of a reference type (i32 <-> i32&). nullptr if it doesn't have one, like void or function types
+	_type_info* counterpart = nullptr;
+
+	// for function types
+	_type_info* return_type = nullptr;
+	std::vector<_type_info*> argument_types;
+
+	_type_info(bool b, std::string n, decltype(fields) f = {}, bool arr = false): pass_by_reference(b), name(n), id(interner.intern(n)), array(arr), fields(f) {
 		int i = 0;
 		for (auto& [ne, fd] : fields) {
 			fd.index = i++;
@@ -44,33 +81,73 @@ struct _type_info {
 	}
 };
 
+string_interner interner; // has to be constructed before the builtin types below intern their names
 
-type_info_ void_type = std::shared_ptr<_type_info>(new _type_info(false, "void", {}, false));
-type_info_ null_type = std::shared_ptr<_type_info>(new _type_info(false, "null", {}, false)); // implicitly converts to any reference type
+arena type_storage; // every _type_info lives here, for the whole compilation
 
-type_info_ i32_type = std::shared_ptr<_type_info>(new _type_info(false, "i32", {}, false));
-type_info_ f64_type = std::shared_ptr<_type_info>(new _type_info(false, "f64", {}, false));
-type_info_ bool_type = std::shared_ptr<_type_info>(new _type_info(false, "bool", {}, false));
-type_info_ string_type = std::shared_ptr<_type_info>(new _type_info(false, "string", {}, false));
+// makes the reference type of the given value type
+type_info_ make_reference_type(type_info_ value_type) {
+	assert(!value_type->pass_by_reference && value_type->counterpart == nullptr);
+	auto reference_type = type_storage.make<_type_info>(true, value_type->name + "&");
+	reference_type->kind = value_type->kind;
+	reference_type->counterpart = value_type;
+	value_type->counterpart = reference_type;
+	return reference_type;
+}
 
-type_info_ i32_ref_type = std::shared_ptr<_type_info>(new _type_info(true, "i32&", {}, false));
-type_info_ f64_ref_type = std::shared_ptr<_type_info>(new _type_info(true, "f64&", {}, false));
-type_info_ bool_ref_type = std::shared_ptr<_type_info>(new _type_info(true, "bool&", {}, false));
-type_info_ string_ref_type = std::shared_ptr<_type_info>(new _type_info(true, "string&", {}, false));
+// key of function_types, the return type followed by the argument types
+struct type_list_hash {
+	size_t operator()(const std::vector<type_info_>& types) const {
+		size_t h = types.size();
+		for (auto t : types) h = h * 31 + std::hash<type_info_>{}(t);
+		return h;
+	}
+};
 
-class operand {
-public:
-	// returns the MCASM needed to retrieve the operand's value, and the MCASM symbol name in which that value is stored.
-	//virtual std::pair<std::string, std::string> retrieve_asmvar() = 0;
+std::unordered_map<std::vector<type_info_>, type_info_, type_list_hash> function_types;
+
+// the type of functions with the given signature, made the first time it's asked for
+type_info_ function_type(type_info_ return_type, const std::vector<type_info_>& argument_types) {
+	std::vector<type_info_> key = { return_type };
+	key.insert(key.end(), argument_types.begin(), argument_types.end());
+	auto found = function_types.find(key);
+	if (found != function_types.end()) return found->second;
+
+	std::string name = return_type->name + "(";
+	for (size_t i = 0; i < argument_types.size(); i++) {
+		if (i != 0) name += ",";
+		name += argument_types[i]->name;
+	}
+	name += ")";
+
+	auto t = type_storage.make<_type_info>(false, name);
+	t->kind = type_kind::function;
+	t->return_type = return_type;
+	t->argument_types = argument_types;
+	function_types.emplace(std::move(key), t);
+	return t;
+}
+
+type_info_ void_type = type_storage.make<_type_info>(false, "void");
+type_info_ null_type = type_storage.make<_type_info>(false, "null"); // implicitly converts to any reference type
 
-	// returns the MCASM needed to retrieve the operand's value, and the MCASM varname in which that value is stored, without preceding stuff like sym:<something>. 
-	// Throws if its value isn't in an asmvar (because it's a literal)
-	//virtual std::pair<std::string, std::string> retrieve_asm_varname() = 0;
+type_info_ i32_type = type_storage.make<_type_info>(false, "i32");
+type_info_ f64_type = type_storage.make<_type_info>(false, "f64");
+type_info_ bool_type = type_storage.make<_type_info>(false, "bool");
+type_info_ string_type = type_storage.make<_type_info>(false, "string");
 
-	// returns the MCASM needed to retrieve the operand's value, and the MCASM varname in which that value is stored, with the preceding assembly type like sym:<something>. 
-	virtual std::pair<std::string, std::string> retrieve_asm_value() = 0;
+type_info_ i32_ref_type = make_reference_type(i32_type);
+type_info_ f64_ref_type = make_reference_type(f64_type);
+type_info_ bool_ref_type = make_reference_type(bool_type);
+type_info_ string_ref_type = make_reference_type(string_type);
+
+class operand {
+public:
+	// emits the MCASM needed to retrieve the operand's value, and returns where that value is: a sym: operand, or an immediate for literals.
+	virtual mcasm_operand retrieve_asm_value() = 0;
 
-	virtual std::pair<std::string, std::string> retrieve_asm_value_copy() = 0;
+	// same, but the value is a copy that's safe to change (or an immediate)
+	virtual mcasm_operand retrieve_asm_value_copy() = 0;
 
 	virtual type_info_ get_type() = 0;
 
@@ -83,44 +160,56 @@ public:
 class varname : public operand {
 public:
 	std::string symname;
-	std::string asmvarname;
+	symbol_id asmvarname;
 	type_info_ type;
 
-	varname(std::string avn, type_info_ type, std::string svn = COMPILER_TEMP_NAME);
+	varname(symbol_id avn, type_info_ type, std::string svn = COMPILER_TEMP_NAME);
 
 	// effectively returns reference
-	std::pair<std::string, std::string> retrieve_asm_value() override {
-		return std::make_pair("", "sym:" + asmvarname);
+	mcasm_operand retrieve_asm_value() override {
+		return mcasm_operand::value_of(asmvarname);
 	}
 
-	std::pair<std::string, std::string> retrieve_asm_value_copy() override {
-		auto copy_name = get_next_assembly_name() + "_copy";
-		return std::make_pair(copy(copy_name, asmvarname), copy_name);
+	mcasm_operand retrieve_asm_value_copy() override {
+		auto copy_name = get_next_assembly_name("_copy");
+		copy(copy_name, mcasm_operand::value_of(asmvarname));
+		return mcasm_operand::value_of(copy_name);
 	}
 
-	//std::pair<std::string, std::string> retrieve_asm_varname() override {
-		//return std::make_pair("", asmvarname);
-	//}
-
 	type_info_ get_type() override { return type; }
 };
 
+// its value is the function itself. the definition (dfunc ... endfunc) isn't part of its value, the statement it's in emits it (see statement::functions).
+class function_literal : public operand {
+public:
+	symbol_id asm_name;
+	type_info_ type;
+	type_info_ return_type;
+	std::vector<symbol_id> parameter_asm_names;
+	block body;
+	symbol_id end_label = no_symbol; // return statements jump here, set when the definition is generated
+
+	function_literal(symbol_id avn) : asm_name(avn) {}
+
+	mcasm_operand retrieve_asm_value() override {
+		return mcasm_operand::value_of(asm_name);
+	}
+
+	mcasm_operand retrieve_asm_value_copy() override {
+		auto copy_name = get_next_assembly_name("_copy");
+		copy(copy_name, mcasm_operand::value_of(asm_name));
+		return mcasm_operand::value_of(copy_name);
+	}
 
-// lexer?
-struct tokenizer_context {
-	int current_line_number = 1;
+	type_info_ get_type() override { return type; }
 };
 
+
 enum class parsing_task {
 	code_body,
 	class_body
 };
 
-enum class symbol_type {
-	variable, // (functions are variables too)
-	type
-};
-
 enum class scope_type {
 	while_,
 	for_,
@@ -133,27 +222,18 @@ enum class scope_type {
 class varname;
 
 struct scope {
-	std::unordered_map<std::string, symbol_type> known_symbols;
-	std::unordered_map < std::string, std::shared_ptr<varname>> variables = {};
-	std::unordered_map<std::string, type_info_> types = {
-		{void_type->name, void_type},
-		{i32_type->name, i32_type},
-		{i32_ref_type->name, i32_ref_type},
-		{f64_type->name, f64_type},
-		{f64_ref_type->name, f64_ref_type},
-		{bool_type->name, bool_type},
-		{bool_ref_type->name, bool_ref_type},
-		{string_type->name, string_type},
-		{string_ref_type->name, string_ref_type},
-	};
 	scope_type type;
 	bool should_return = false;
 	type_info_ return_type = void_type;
+	function_literal* function = nullptr; // if this is a function's scope
+	size_t symbols_mark = 0; // where its names start in parser_context::symbols, set by push_scope
 };
 
 struct parsing_task_info {
 	parsing_task task;
 	int line_number = -1;
+	block* body = nullptr; // where statements of a code body go
+	if_statement* if_chain = nullptr; // if this code body is a branch of an if, so a following else/elseif can be added to it
 };
 
 //struct function_info {
@@ -170,153 +250,80 @@ struct parsing_task_info {
 struct parser_context {
 	std::vector<parsing_task_info> taskStack;
 	std::vector<scope> scopeStack;
+	symbol_table symbols; // every name in scopeStack
 
-
-	std::vector<type_info_> extract_arguments(type_info_ function_type) {
-		std::string t = function_type->name;
-		assert(t.find_first_of("(") != std::string::npos);
-		type_info_ ret_type = is_type(t.substr(0, t.find_first_of("(")));
-		t = t.substr(t.find_first_of("(") + 1, t.find_last_of(")") - t.find_first_of("("));
-		std::vector<type_info_> arg_types = {};
-		while (!t.empty()) {
-			arg_types.push_back(is_type(t.substr(0, t.find_first_of("),")-1))); // todo: more powerful solution needed to remove duplicate code and enable function types as parameters/return values
-			t = t.substr(t.find_first_of("),") + 1);
-			if (arg_types.back() == nullptr) arg_types.pop_back();
-		}
-		return arg_types;
+	void push_scope(scope s) {
+		s.symbols_mark = symbols.mark();
+		scopeStack.push_back(s);
 	}
 
-	type_info_ extract_return_type(type_info_ function_type) {
-		return is_type(function_type->name.substr(0, function_type->name.find_first_of("(")));
+	void pop_scope() {
+		symbols.undo(scopeStack.back().symbols_mark);
+		scopeStack.pop_back();
 	}
 
-	// returns nullptr if not, otherwise will return type of literal
-	std::optional<type_info_> is_literal(std::string literal) {
-		// boolean literal
-		if (literal == "true" || literal == "false") return bool_type;
+	arena nodes; // the AST (statements and operands), lives until compilation is over
 
-		// null literal
-		if (literal == "null") return null_type;
+	// function literals that have been parsed but not given to the statement they're in yet
+	std::vector<function_literal*> pending_functions;
 
-		// string literal
-		if (literal.size() >= 2 && literal[0] == '\"' && literal.back() == '\"') return string_type;
+	// gives the statement the function literals parsed since first_function
+	void take_pending_functions(statement* s, size_t first_function) {
+		s->functions.insert(s->functions.end(), pending_functions.begin() + first_function, pending_functions.end());
+		pending_functions.resize(first_function);
+	}
 
-		// numeric literal (stolen from https://medium.com/@ryan_forrester_/c-check-if-string-is-number-practical-guide-c7ba6db2febf)
-		static const std::regex number_regex(
-			R"(^[-+]?(?:\d+(?:\.\d*)?|\.\d+)(?:[eE][-+]?\d+)?$)"
-		);
-		if (std::regex_match(literal, number_regex)) {
-			if (literal.find_first_of(".") != std::string::npos) {
-				return f64_type;
-			}
-			else {
-				return i32_type;
-			}
-		}
-		else {
-			return std::nullopt;
-		}
+	// adds the statement to the code body being parsed (or the given one)
+	void add_statement(statement* s, size_t first_function, block* body = nullptr) {
+		take_pending_functions(s, first_function);
+		(body ? body : taskStack.back().body)->statements.push_back(s);
 	}
 
-	bool is_variable(std::string symbol) {
-		for (auto it = scopeStack.rbegin(); it != scopeStack.rend(); it++) {
-			//if (it->known_symbols.count(symbol) && it->known_symbols[symbol] == symbol_type::variable) {
-			if (it->variables.contains(symbol))
-				return true;
-			//}
+
+	// type of a literal token, the tokenizer already knows what kind of literal it is
+	type_info_ literal_type(token_kind kind) {
+		switch (kind) {
+		case token_kind::integer_literal: return i32_type;
+		case token_kind::float_literal: return f64_type;
+		case token_kind::string_literal: return string_type;
+		case token_kind::bool_literal: return bool_type;
+		case token_kind::null_literal: return null_type;
+		default: assert(false); return nullptr;
 		}
-		return false;
 	}
 
-	std::shared_ptr<varname> get_variable(std::string varname) {
-		assert(is_variable(varname));
-		for (auto it = scopeStack.rbegin(); it != scopeStack.rend(); it++)
-			//if (it->known_symbols.count(symbol) && it->known_symbols[symbol] == symbol_type::variable) {
-			if (it->variables.contains(varname))
-				return it->variables[varname];
+	bool is_variable(symbol_id symbol) {
+		auto b = symbols.find(symbol);
+		return b && b->kind == symbol_type::variable;
 	}
 
-	type_info_ is_basic_type(std::string symbol) { // returns nullptr if no
-		for (auto it = scopeStack.rbegin(); it != scopeStack.rend(); it++) {
-			if (it->types.count(symbol)) {
-				return it->types[symbol];
-			}
-		}
-		return nullptr;
+	varname* get_variable(symbol_id symbol) {
+		assert(is_variable(symbol));
+		return symbols.find(symbol)->variable;
 	}
-		
-	std::unordered_map<std::string, type_info_> type_cache = {};
-
-	type_info_ is_type(std::string symbol) { // returns nullptr if no
-		assert(symbol != "var"); // handle this on ur own bucko
-
-		if (is_basic_type(symbol)) return is_basic_type(symbol);
-		else { // function type
-			int first = symbol.find_first_of("(");
-			int second = symbol.find_last_of(")");
-			if (first != std::string::npos && first == symbol.find_last_of("(") && second == symbol.find_first_of(")") && second == symbol.size() - 1 && first < second) {
-				int i = first + 1;
-
-				std::string currentType;
-				int typeState = 0; // 0 means future letters must be whitespace or part of a type or comma, 1 means future characters must be whitespace or a comma
-				while (i < second) {
-					if (symbol[i] == ' ' || symbol[i] == '\t' || symbol[i] == '\n') {
-						if (typeState == 0) {
-							typeState = 1;
-							if (!is_basic_type(currentType)) throw std::runtime_error(std::string("unrecognized type ") + currentType);
-							currentType = "";
-						}
-					}
-					else if (symbol[i] == ',') {
-						if (typeState == 1) {
-							typeState = 0;
-						}
-
-						if (!is_basic_type(currentType)) throw std::runtime_error(std::string("unrecognized type ") + currentType);
-						currentType = "";
-					}
-					else if (symbol[i] == '&') {
-						if (typeState == 1) throw std::runtime_error("expected \",\", not \"&\"");
-						if (currentType.empty()) throw std::runtime_error("type may not begin with \"&\"");
-						currentType += "&";
-					}
-					else if (std::isdigit(symbol[i])) {
-						if (typeState == 1) throw std::runtime_error("expected \",\", not type");
-						if (currentType.empty()) throw std::runtime_error("type may not begin with digit");
-						currentType += symbol[i];
-					}
-					else if (std::isalpha(symbol[i])) {
-						if (typeState == 1) throw std::runtime_error("expected \",\", not type");
-						if (currentType.size() > 0 && currentType.back() == '&') throw std::runtime_error("expected \"&\" or \",\" after \"&\"");
-						currentType += symbol[i];
-					}
-					else {
-						throw std::runtime_error("invalid character in function type specification");
-					}
 
-					i++;
-				}
-				
-				if (type_cache.contains(symbol)) return type_cache[symbol];
-				else {
-					type_cache[symbol] = std::shared_ptr<_type_info>(new _type_info(false, symbol, {}, false));
-					return type_cache[symbol];
-				}
-			}
+	type_info_ is_basic_type(symbol_id symbol) { // returns nullptr if no
+		auto b = symbols.find(symbol);
+		return b && b->kind == symbol_type::type ? b->type : nullptr;
+	}
 
-			return nullptr;
-		}
+	type_info_ is_type(symbol_id id) { // returns nullptr if no
+		if (id == no_symbol) return nullptr;
+		assert(interner.name(id) != "var"); // handle this on ur own bucko
+		return is_basic_type(id);
 	}
 
-	bool is_symbol(std::string symbol) {
+	bool is_symbol(symbol_id symbol) {
 		return is_type(symbol) || is_variable(symbol);
 	}
 
-	bool is_valid_symbol_name(std::string name) {
+	bool is_valid_symbol_name(symbol_id symbol) {
+		assert(symbol != no_symbol);
+		std::string_view name = interner.name(symbol);
 		assert(!name.empty());
-		if (is_symbol(name)) return false;
+		if (is_symbol(symbol)) return false;
 		if (!std::isalpha(name[0])) return false;
-		for (char& c : name) {
+		for (char c : name) {
 			if (!std::isalnum(c)) return false;
 		}
 		return true;
@@ -338,50 +345,6 @@ struct parser_context {
 
 tokenizer_context tokenizer;
 parser_context parser;
-std::string src, out;
-
-
-// returns the script backwards.
-std::string get_src(std::string path) {
-	std::ifstream file(path);
-	if (!file.is_open()) {
-		std::cout << "Failure to open " << path << "\n";
-		throw std::runtime_error("Invalid path " + path);
-	}
-
-	std::stringstream buffer;
-	buffer << file.rdbuf();
-
-	file.close();
-
-	assert(buffer.good());
-
-	auto src = buffer.str();
-	std::reverse(src.begin(), src.end());
-
-	return src;
-}
-
-// if a token contains this character, then this character is the last and only character in the token.
-//const std::vector<char> ALWAYS_LAST = {
-	
-//};
-
-// if this character is in a token, then it is the only character in that token.
-const std::vector<char> ALWAYS_STANDALONE = {
-	' ',
-	'(',
-	')',
-	'[',
-	']',
-	'{',
-	'}',
-	';',
-	':',
-	',',
-	'\t',
-	'\n'
-}; 
 
 enum associativity {
 	left_to_right,
@@ -390,51 +353,50 @@ enum associativity {
 
 class expression;
 struct binary_operator;
-//using operand = std::variant<literal, varname, funccall, std::shared_ptr<expression>, operator_>;
 
 
 
-static const inline std::string return_asmvar = "ret";
+const symbol_id return_asmvar = interner.intern("ret");
 
-std::string copy(std::string asmdst, std::string asmsrc) {
-	if (asmsrc.substr(0, 4) == "sym:") asmsrc = asmsrc.substr(4);
-	if (asmdst.substr(0, 4) == "sym:") asmdst = asmdst.substr(4);
-	assert(asmdst.find_first_of(":") == std::string::npos);
-	if (asmsrc.find_first_of(":") != std::string::npos) {
-		return "\ndvar " + asmdst + " " + asmsrc;
+void copy(symbol_id asmdst, mcasm_operand asmsrc) {
+	if (asmsrc.is_immediate()) {
+		out.emit(opcode::dvar, { mcasm_operand::variable(asmdst), asmsrc });
 	}
 	else {
-		return "\ncvar " + asmsrc + " " + asmdst;
+		out.emit(opcode::cvar, { asmsrc.as_variable(), mcasm_operand::variable(asmdst) });
 	}
 }
 
-// returns the code to convert the value of the given variable of the given type into the second type, if such a conversion is legal under implicit conditions (between binary operators). 
-std::optional<std::string> implicit_convert_to_type(std::string asm_varname, type_info_ ti_type, type_info_ tf_type) {
+// whether a value of the first type can be converted into the second under implicit conditions (between binary operators)
+bool can_implicitly_convert(type_info_ ti_type, type_info_ tf_type) {
 	assert(!ti_type->pass_by_reference && !tf_type->pass_by_reference);
-	if (ti_type == tf_type) 
-		return "";// "\ndvar " + tf_asm_varname + " sym:" + ti_asm_varname;
-	else if (tf_type == f64_type) {
-		if (ti_type == i32_type) {
-			return "\ns2d sym:" + asm_varname + " " + asm_varname;
-		}
-		else {
-			return std::nullopt;
-		}
-	}
-	else return std::nullopt;
+	return ti_type == tf_type || (tf_type == f64_type && ti_type == i32_type);
+}
+
+// converts the given value (a copy that can be changed, or an immediate) of the given type into the second type and returns the converted value, if such a conversion is legal under implicit conditions (between binary operators).
+// immediates are converted right away, without generating anything.
+std::optional<mcasm_operand> implicit_convert_to_type(mcasm_operand value, type_info_ ti_type, type_info_ tf_type) {
+	if (!can_implicitly_convert(ti_type, tf_type)) return std::nullopt;
+	if (ti_type == tf_type) return value;
+
+	// i32 -> f64
+	if (value.kind == mcasm_operand::kind_t::sint) return mcasm_operand::dbl(value.int_value);
+	out.emit(opcode::s2d, { value, value.as_variable() });
+	return value;
 }
 
-// returns the code to convert the value of the given variable of the given type into the second type, if such a conversion is legal under explicit conditions. 
-std::optional<std::string> explicit_convert_to_type(std::string asm_varname, type_info_ ti_type, type_info_ tf_type) {
-	auto attempt = implicit_convert_to_type(asm_varname, ti_type, tf_type);
-	if (attempt.has_value()) return attempt;
+// same as implicit_convert_to_type, but if such a conversion is legal under explicit conditions.
+std::optional<mcasm_operand> explicit_convert_to_type(mcasm_operand value, type_info_ ti_type, type_info_ tf_type) {
+	if (can_implicitly_convert(ti_type, tf_type)) return implicit_convert_to_type(value, ti_type, tf_type);
 	else if (tf_type == i32_type) {
 		if (ti_type == f64_type) {
-			return "\nd2s sym:" + asm_varname + " " + asm_varname;
+			if (value.kind == mcasm_operand::kind_t::dbl) return mcasm_operand::sint(static_cast<int32_t>(value.float_value));
+			out.emit(opcode::d2s, { value, value.as_variable() });
+			return value;
 		}
 		else if (ti_type == bool_type) {
 			// boolean is already sint of either 1 or 2, this is easy
-			return "";
+			return value;
 		}
 		else {
 			return std::nullopt;
@@ -443,60 +405,70 @@ std::optional<std::string> explicit_convert_to_type(std::string asm_varname, typ
 	else if (tf_type == f64_type) {
 		if (ti_type == bool_type) {
 			// same as an int cast
-			return "\ns2d sym:" + asm_varname + " " + asm_varname;
+			if (value.kind == mcasm_operand::kind_t::sint) return mcasm_operand::dbl(value.int_value);
+			out.emit(opcode::s2d, { value, value.as_variable() });
+			return value;
 		}
 		else {
 			return std::nullopt;
 		}
 	}
+	return std::nullopt;
 }
 
 class funccall : public operand {
 public:
-	std::shared_ptr<operand> function;
-	std::vector<std::shared_ptr<expression>> args;
-	std::pair<std::string, std::string> retrieve_asm_value() override;
-	std::pair < std::string, std::string> retrieve_asm_value_copy() override { return retrieve_asm_value(); };
-	type_info_ get_type() { assert(function); assert(function->get_type()); return parser.extract_return_type(function->get_type()); }
+	operand* function;
+	std::vector<expression*> args;
+	mcasm_operand retrieve_asm_value() override;
+	mcasm_operand retrieve_asm_value_copy() override { return retrieve_asm_value(); };
+	type_info_ get_type() {
+		assert(function);
+		auto function_type = function->get_type();
+		if (function_type->kind != type_kind::function) throw std::runtime_error("cannot call a value of type " + function_type->name);
+		return function_type->return_type;
+	}
 	~funccall() = default;
 };
 
 class literal : public operand {
 public:
 	type_info_ type;
-	std::string value;
-
-	literal(type_info_ t, std::string v) : type(t), value(v) {};
-
-	std::pair<std::string, std::string> retrieve_asm_value() override {
-		auto literaltype = parser.is_literal(value);
-		assert(literaltype);
+	std::string value; // source text, only looked at for strings
+	int32_t int_value = 0; // i32s and bools, already parsed by the tokenizer
+	double float_value = 0.0; // f64s, already parsed by the tokenizer
+
+	literal(type_info_ t, std::string v, int32_t i = 0, double f = 0.0) : type(t), value(v), int_value(i), float_value(f) {};
+	literal(const token& t) : literal(parser.literal_type(t.kind), std::string(t.text), t.int_value, t.float_value) {};
+
+	// what a string literal actually says
+	std::string string_value() const {
+		std::string bytes;
+		std::string_view litstr = value.empty() ? std::string_view() : std::string_view(value).substr(1, value.size() - 2); // (defaults are empty)
+		bool escaped = false;
+		for (char c : litstr) {
+			// the tokenizer leaves escapes in, a backslash just means take the next character literally
+			if (c == '\\' && !escaped) {
+				escaped = true;
+				continue;
+			}
+			escaped = false;
+			bytes += c;
+		}
+		return bytes;
+	}
 
-		if (literaltype == null_type) return std::make_pair("", "sint:0");
-		else if (literaltype == string_type) {
-			std::string v = "str:";
-			if (value == "") v += "null";
-			else {
-				std::string litstr = value.substr(1, value.size() - 2);
-				for (char c : litstr) {
-					v += std::to_string((uint8_t)c) + ",";
-				}
-			}
-			v.pop_back();
-			return std::make_pair("", v);
-		}
-		else if (literaltype == bool_type) return std::make_pair("", value == "true" ? "sint:1" : "sint:0");
-		else if (literaltype == i32_type) return std::make_pair("", "sint:" + value);
-		else if (literaltype == f64_type) return std::make_pair("", "dbl:" + value);
+	mcasm_operand retrieve_asm_value() override {
+		if (type == null_type) return mcasm_operand::sint(0);
+		else if (type == string_type) return out.string_constant(string_value());
+		else if (type == bool_type) return mcasm_operand::sint(int_value ? 1 : 0);
+		else if (type == i32_type) return mcasm_operand::sint(int_value);
+		else if (type == f64_type) return mcasm_operand::dbl(float_value);
 		else assert(false);
+		return {};
 	}
 
-	//std::pair<std::string, std::string> retrieve_asm_varname() override {
-		//assert(false); // attempt to find assembly variable name of a constant
-		//abort();
-	//}
-
-	std::pair<std::string, std::string> retrieve_asm_value_copy() override {
+	mcasm_operand retrieve_asm_value_copy() override {
 		return retrieve_asm_value();
 	}
 
@@ -507,265 +479,276 @@ public:
 
 
 
-struct binary_operator_result {
-	type_info_ type = nullptr; // the type stored in the given variable
-	std::string src = ""; // the MCASM that will store the result of applying this operand on its two arguments
-};
-
 struct binary_operator {
 	associativity a = associativity::left_to_right;
-	int priority = 100; // highest first
+	int priority = 0; // highest first, 0 if it's not a binary operator
+
+	// returns the type of the result of this operation, without generating anything. throws if the operands can't be used with it.
+	// this is what the type-inference pass uses, so by the time func runs the operands are known to be fine.
+	std::function<type_info_(operand&, operand&)> result_type =
+		[](operand&, operand&) -> type_info_ { throw std::runtime_error("operator is unimplemented"); };
+
+	// emits the code needed to store the result of this operation in the given assembly variable name, and returns where the result is. (the variable being store to must already be declared)
+	// that's normally the variable, but it's an immediate if the result was worked out at compile time (and then nothing is emitted), or an operand's value if the operation wouldn't change it.
+	std::function<mcasm_operand(symbol_id, operand&, operand&)> func =
+		[](symbol_id, operand&, operand&) -> mcasm_operand { assert(false); return {}; };
 
-	// returns the code needed to store the result of this operation in the given assembly variable name. (the variable being store to must already be declared)
-	std::function<binary_operator_result(std::string, operand&, operand&)> func =
-		[](std::string, operand&, operand&) { assert(false); return binary_operator_result {}; };
+	// whether func gets its operands evaluated already, into variables or immediates. if not, it gets them as they are and evaluates them itself, if it needs to.
+	bool evaluates_operands = true;
+
+	// for comparisons, the conditional jumps that are taken when it's false (for ints, and for doubles).
+	// conditions use them to jump on the comparison directly, instead of on its result (see branch_if).
+	std::optional<std::pair<opcode, opcode>> jump_if_false = {};
 };
 
 struct unary_operator {
-	int priority = 70;
-	std::function < std::string(std::string, operand&)> func = [](std::string, operand&) {assert(false); return ""; };
-};
+	int priority = 0; // 0 if it's not a unary operator
 
-std::unordered_map<std::string, unary_operator> unary_operators{
-	//{"-", operator_ {.unary = true}},
-	{"!", unary_operator {}}
+	// same as binary_operator's
+	std::function<type_info_(operand&)> result_type =
+		[](operand&) -> type_info_ { throw std::runtime_error("operator is unimplemented"); };
+	std::function<mcasm_operand(symbol_id, operand&)> func =
+		[](symbol_id, operand&) -> mcasm_operand { assert(false); return {}; };
 };
 
-std::string without_ref(std::string type) {
-	if (type.back() == '&') {
-		type.pop_back();
-	}
-	assert(parser.is_type(type));
-	return type;
+constexpr size_t operator_count = static_cast<size_t>(operator_id::none);
+
+// the operator tables are arrays indexed by operator_id
+template <typename T>
+std::array<T, operator_count> make_operator_table(std::initializer_list<std::pair<operator_id, T>> entries) {
+	std::array<T, operator_count> table{};
+	for (auto& [id, op] : entries) table[static_cast<size_t>(id)] = op;
+	return table;
 }
 
-// handle4th: if 0 instruction takes 3 args, if 1 we discard 3rd arg and store 4th, if 2 we discard 4th and store 3rd
-// TODO: HANDLE REFERENCE TYPES
-std::function < binary_operator_result(std::string, operand&, operand&)> make_math_func(std::string dblinstruction, std::string intinstruction, bool modifyFirst = false, int handle4th = 0) {
-	return [dblinstruction, intinstruction, handle4th, modifyFirst](std::string varname, operand& o1, operand& o2) {
-		std::string out;
-		auto [src1, o1v] = o1.retrieve_asm_value();
-		out += src1;
-		auto [src2, o2v] = o2.retrieve_asm_value();
-		out += src2;
+// result_type of make_math_func's operators. if modifyFirst, o1 is assigned to so its type can't change.
+std::function<type_info_(operand&, operand&)> make_math_type(bool modifyFirst = false) {
+	return [modifyFirst](operand& o1, operand& o2) -> type_info_ {
+		auto t1 = o1.get_referenceless_type(), t2 = o2.get_referenceless_type();
+		if (t1 == f64_type || t2 == f64_type) {
+			// the other one has to implicitly convert to f64
+			if (t1 != f64_type && (modifyFirst || t1 != i32_type)) throw std::runtime_error("incompatible operands");
+			if (t2 != f64_type && t2 != i32_type) throw std::runtime_error("incompatible operands");
+			return f64_type;
+		}
+		else if (t1 == i32_type && t2 == i32_type) {
+			return i32_type;
+		}
+		throw std::runtime_error("incompatible operands");
+	};
+}
 
-		
+// result_type of make_comparison_operator's operators
+std::function<type_info_(operand&, operand&)> make_comparison_type() {
+	return [](operand& o1, operand& o2) -> type_info_ {
+		auto t1 = o1.get_referenceless_type(), t2 = o2.get_referenceless_type();
+		if (t1 == f64_type || t2 == f64_type) {
+			if ((t1 != f64_type && t1 != i32_type) || (t2 != f64_type && t2 != i32_type)) throw std::runtime_error("incompatible operands");
+		}
+		else if (t1 == i32_type || t2 == i32_type) {
+			if (t1 != t2) throw std::runtime_error("incompatible operands");
+		}
+		else if (!can_implicitly_convert(t1, t2) && !can_implicitly_convert(t2, t1)) {
+			throw std::runtime_error("incompatible operands");
+		}
+		return bool_type;
+	};
+}
 
-		type_info_ outtype = nullptr;
+// the operand's value converted to the given type, in a copy if it has to be converted (so the operand itself doesn't change)
+static mcasm_operand retrieve_converted_value(operand& o, type_info_ type) {
+	if (o.get_referenceless_type() == type) return o.retrieve_asm_value();
+	auto converted = implicit_convert_to_type(o.retrieve_asm_value_copy(), o.get_referenceless_type(), type); // conversion from i32&, f64&, etc. is same without reference qualifier
+	if (!converted.has_value()) throw std::runtime_error("incompatible operands");
+	return *converted;
+}
 
-		if (handle4th == 1) varname = "discard_result " + varname;
-		else if (handle4th == 2) varname = varname + " discard_result";
-			
-		if (o1.get_referenceless_type() == f64_type || o2.get_type() == f64_type) {
-			if (dblinstruction == "dmul") {
-				std::cout << "";
-			}
+static bool is_sint(mcasm_operand o, int32_t value) {
+	return o.kind == mcasm_operand::kind_t::sint && o.int_value == value;
+}
 
-			outtype = f64_type;
-			if (o1.get_referenceless_type() != f64_type) {
-				if (!modifyFirst) { // then we can implictly convert o2's type
-					// copy o1 bc we don't want to change value of o1v.
-					auto copy = o1.retrieve_asm_value_copy();
-					o1v = copy.second;
-					src1 = copy.first;
-					auto conv_code = implicit_convert_to_type(o1v, o1.get_referenceless_type(), f64_type); // conversion from i32&, f64&, etc. to i32 is same without reference qualifier
-					if (conv_code.has_value())
-						src1 += *conv_code;
-					else
-						throw std::runtime_error("incompatible operands");
-				}
-				else {
-					throw std::runtime_error("incompatible operands");;
-				}
-			}
-			else if (o2.get_referenceless_type() != f64_type) {
-				// then we can implictly convert o2's type
-				// copy o2 bc we don't want to change value of o1v.
-				auto copy = o2.retrieve_asm_value_copy();
-				o2v = copy.second;
-				src2 = copy.first;
-				auto conv_code = implicit_convert_to_type(o2v, o2.get_referenceless_type(), f64_type);
-				if (conv_code.has_value())
-					src2 += *conv_code;
-				else
-					throw std::runtime_error("incompatible operands");
-			}
+// the result of the arithmetic instruction, if it can be known at compile time.
+// division isn't folded, what sdiv rounds to (and what dividing by 0 does) is up to the VM.
+static std::optional<mcasm_operand> fold_arithmetic(opcode instruction, mcasm_operand a, mcasm_operand b) {
+	using kind = mcasm_operand::kind_t;
+	if (a.kind == kind::sint && b.kind == kind::sint) {
+		// (unsigned so overflow wraps around like it does in the VM's 32 bit ints, instead of being UB)
+		uint32_t x = a.int_value, y = b.int_value;
+		switch (instruction) {
+		case opcode::sadd: return mcasm_operand::sint(static_cast<int32_t>(x + y));
+		case opcode::ssub: return mcasm_operand::sint(static_cast<int32_t>(x - y));
+		case opcode::smul: return mcasm_operand::sint(static_cast<int32_t>(x * y));
+		default: return std::nullopt;
+		}
+	}
+	if (a.kind == kind::dbl && b.kind == kind::dbl) {
+		switch (instruction) {
+		case opcode::dadd: return mcasm_operand::dbl(a.float_value + b.float_value);
+		case opcode::dsub: return mcasm_operand::dbl(a.float_value - b.float_value);
+		case opcode::dmul: return mcasm_operand::dbl(a.float_value * b.float_value);
+		default: return std::nullopt;
+		}
+	}
 
+	// identities, only for ints (x + 0.0 isn't x if x is -0.0). these return the other operand as is, so it's up to the caller to copy it if it isn't an immediate.
+	// the operands were already evaluated, so leaving one out can't leave out any side effects.
+	switch (instruction) {
+	case opcode::smul:
+		if (is_sint(a, 0) || is_sint(b, 0)) return mcasm_operand::sint(0);
+		if (is_sint(b, 1)) return a;
+		if (is_sint(a, 1)) return b;
+		break;
+	case opcode::sadd:
+		if (is_sint(b, 0)) return a;
+		if (is_sint(a, 0)) return b;
+		break;
+	case opcode::ssub:
+		if (is_sint(b, 0)) return a;
+		break;
+	default:
+		break;
+	}
+	return std::nullopt;
+}
 
-			out += "\n" + dblinstruction + " " + o1v + " " + o2v + " " + varname;
+// handle4th: if 0 instruction takes 3 args, if 1 we discard 3rd arg and store 4th, if 2 we discard 4th and store 3rd
+// TODO: HANDLE REFERENCE TYPES
+std::function<mcasm_operand(symbol_id, operand&, operand&)> make_math_func(opcode dblinstruction, opcode intinstruction, bool modifyFirst = false, int handle4th = 0) {
+	return [dblinstruction, intinstruction, handle4th, modifyFirst](symbol_id varname, operand& o1, operand& o2) {
+		type_info_ outtype = nullptr;
+		opcode instruction;
+		if (o1.get_referenceless_type() == f64_type || o2.get_referenceless_type() == f64_type) {
+			outtype = f64_type;
+			instruction = dblinstruction;
 		}
 		else if (o1.get_referenceless_type() == i32_type || o2.get_referenceless_type() == i32_type) {
 			outtype = i32_type;
-			if (o1.get_referenceless_type() != i32_type) {
-				if (!modifyFirst) {
-					// copy o1 bc we don't want to change value of o1v.
-					auto copy = o1.retrieve_asm_value_copy();
-					o1v = copy.second;
-					src1 = copy.first;
-					auto conv_code = implicit_convert_to_type(o1v, o1.get_referenceless_type(), i32_type);
-					if (conv_code.has_value())
-						src1 += *conv_code;
-					else
-						throw std::runtime_error("incompatible operands");
-				}
-				else {
-					throw std::runtime_error("incompatible operands");;
-				}
-			}
-			else if (o2.get_referenceless_type() != i32_type) {
-				// copy o2 bc we don't want to change value of o1v.
-				auto copy = o2.retrieve_asm_value_copy();
-				o2v = copy.second;
-				src2 = copy.first;
-				auto conv_code = implicit_convert_to_type(o2v, o2.get_referenceless_type(), i32_type); //  conversion from i32&, f64&, etc. to i32 is same without reference qualifier
-				if (conv_code.has_value())
-					src2 += *conv_code;
-				else
-					throw std::runtime_error("incompatible operands");
-			}
-
-			out += "\n" + intinstruction + " " + o1v + " " + o2v + " " + varname;
+			instruction = intinstruction;
 		}
 		else {
 			throw std::runtime_error("incompatible operands");
 		}
-		//return "\ndvar " + varname + " "
+
+		// o1 is assigned to if modifyFirst, so then it can't be converted
+		if (modifyFirst && o1.get_referenceless_type() != outtype) throw std::runtime_error("incompatible operands");
+		auto o1v = retrieve_converted_value(o1, outtype);
+		auto o2v = retrieve_converted_value(o2, outtype);
+
+		if (!modifyFirst && handle4th == 0) {
+			if (auto folded = fold_arithmetic(instruction, o1v, o2v)) {
+				if (folded->is_immediate()) return *folded;
+				// an identity like x + 0, which still has to be a copy of x (x itself would change whenever x does)
+				copy(varname, *folded);
+				return mcasm_operand::value_of(varname);
+			}
+		}
+
+		auto result = mcasm_operand::variable(varname);
+		if (handle4th == 0) {
+			out.emit(instruction, { o1v, o2v, result });
+		}
+		else { // (the half of the division that isn't wanted still has to go in a variable)
+			auto discarded = mcasm_operand::variable(get_next_assembly_name("_discard"));
+			out.emit(opcode::dvar, { discarded, mcasm_operand::sint(0) });
+			if (handle4th == 1) out.emit(instruction, { o1v, o2v, discarded, result });
+			else out.emit(instruction, { o1v, o2v, result, discarded });
+		}
 
 		if (modifyFirst) {
-			out += copy(o1v, varname);
+			copy(o1v.as_variable().name, mcasm_operand::value_of(varname));
 		}
 
-		return binary_operator_result{ .type = outtype, .src = out };
+		return mcasm_operand::value_of(varname);
 	};
 }
 
-std::string get_next_label_name() {
+symbol_id get_next_label_name(std::string_view suffix = "") {
 	static int j = 0;
-	return "l_" + std::to_string(j++);
+	return interner.intern("l_" + std::to_string(j++) + std::string(suffix));
 }
 
-// takes the instruction that would make the condition false
-std::function <binary_operator_result(std::string, operand&, operand&)> make_comparison_operator(std::string intinstruction, std::string dblinstruction) {
-	return [intinstruction, dblinstruction](std::string varname, operand& o1, operand& o2) {
-		
-		std::string out = "";
-		type_info_ outtype = bool_type;
-
-		out += "\ndvar " + varname + " sint:0";
-		auto lblname = get_next_label_name() + "_eval_comp";
-		
-		auto [get_o1v_src, o1v] = o1.retrieve_asm_value();
-		auto [get_o2v_src, o2v] = o2.retrieve_asm_value();
+// whether the conditional jump would jump, for two values known at compile time
+template <typename T>
+static bool jump_taken(opcode instruction, T a, T b) {
+	switch (instruction) {
+	case opcode::sje: case opcode::dje: return a == b;
+	case opcode::sjne: case opcode::djne: return a != b;
+	case opcode::sjg: case opcode::djg: return a > b;
+	case opcode::sjge: case opcode::djge: return a >= b;
+	case opcode::sjl: case opcode::djl: return a < b;
+	case opcode::sjle: case opcode::djle: return a <= b;
+	default: assert(false); return false;
+	}
+}
 
-		if (o1.get_referenceless_type() == f64_type || o2.get_referenceless_type() == f64_type) {
-			if (o1.get_referenceless_type() != f64_type) {
-				// copy o1 bc we don't want to change value of o1v.
-				auto copy = o1.retrieve_asm_value_copy();
-				o1v = copy.second;
-				get_o1v_src = copy.first;
-				auto conv_code = implicit_convert_to_type(o1v, o1.get_referenceless_type(), f64_type);
-				if (conv_code.has_value())
-					get_o1v_src += *conv_code;
-				else
-					throw std::runtime_error("incompatible operands");
+// a comparison's operands, converted to the type they're compared as
+struct comparison {
+	opcode jump_if_false = {};
+	mcasm_operand a, b;
+	std::optional<bool> result = {}; // if it's known at compile time
+};
 
-			}
-			else if (o2.get_referenceless_type() != f64_type) {
-				// copy o2 bc we don't want to change value of o2v.
-				auto copy = o2.retrieve_asm_value_copy();
-				o2v = copy.second;
-				get_o2v_src = copy.first;
-				auto conv_code = implicit_convert_to_type(o2v, o2.get_referenceless_type(), f64_type);
-				if (conv_code.has_value())
-					get_o2v_src += *conv_code;
-				else
-					throw std::runtime_error("incompatible operands");
-			}
+// takes the instructions that would make the condition false
+static comparison compare(opcode intinstruction, opcode dblinstruction, operand& o1, operand& o2) {
+	// the type both sides are compared as
+	auto t1 = o1.get_referenceless_type(), t2 = o2.get_referenceless_type();
+	type_info_ comparison_type;
+	opcode instruction = intinstruction;
+	if (t1 == f64_type || t2 == f64_type) {
+		comparison_type = f64_type;
+		instruction = dblinstruction;
+	}
+	else if (t1 == i32_type || t2 == i32_type) {
+		comparison_type = i32_type;
+	}
+	else if (can_implicitly_convert(t1, t2)) {
+		// symbol cast and comparison
+		comparison_type = t2;
+	}
+	else if (can_implicitly_convert(t2, t1)) {
+		comparison_type = t1;
+	}
+	else {
+		throw std::runtime_error("incompatible operands");
+	}
 
-			out += get_o1v_src;
-			out += get_o2v_src;
-			out += "\n" + dblinstruction + " " + lblname + " " + o1v + " " + o2v;
-			out += "\ndvar " + varname + " sint:1";
-			out += "\nlabel " + lblname;
+	comparison c{ .jump_if_false = instruction, .a = retrieve_converted_value(o1, comparison_type), .b = retrieve_converted_value(o2, comparison_type) };
 
-			return binary_operator_result{
-				.type = outtype,
-				.src = out
-			};
-		}
-		else if (o1.get_referenceless_type() == i32_type || o2.get_referenceless_type() == i32_type) {
-			if (o1.get_referenceless_type() != i32_type) {
-				// copy o1 bc we don't want to change value of o1v.
-				auto copy = o1.retrieve_asm_value_copy();
-				o1v = copy.second;
-				get_o1v_src = copy.first;
-				auto conv_code = implicit_convert_to_type(o1v, o1.get_referenceless_type(), i32_type);
-				if (conv_code.has_value())
-					get_o1v_src += *conv_code;
-				else
-					throw std::runtime_error("incompatible operands");
+	// (bools are sints too)
+	using kind = mcasm_operand::kind_t;
+	if (c.a.kind == kind::sint && c.b.kind == kind::sint) c.result = !jump_taken(instruction, c.a.int_value, c.b.int_value);
+	if (c.a.kind == kind::dbl && c.b.kind == kind::dbl) c.result = !jump_taken(instruction, c.a.float_value, c.b.float_value);
+	return c;
+}
 
-			}
-			else if (o2.get_referenceless_type() != i32_type) {
-				// copy o2 bc we don't want to change value of o2v.
-				auto copy = o2.retrieve_asm_value_copy();
-				o2v = copy.second;
-				get_o2v_src = copy.first;
-				auto conv_code = implicit_convert_to_type(o2v, o2.get_referenceless_type(), i32_type);
-				if (conv_code.has_value())
-					get_o2v_src += *conv_code;
-				else
-					throw std::runtime_error("incompatible operands");
-			}
+// takes the instructions that would make the condition false
+binary_operator make_comparison_operator(int priority, opcode intinstruction, opcode dblinstruction) {
+	return binary_operator{ .priority = priority, .result_type = make_comparison_type(), .func = [intinstruction, dblinstruction](symbol_id varname, operand& o1, operand& o2) {
+		auto c = compare(intinstruction, dblinstruction, o1, o2);
+		if (c.result.has_value()) return mcasm_operand::sint(*c.result);
 
-			out += get_o1v_src;
-			out += get_o2v_src;
-			out += "\n" + intinstruction + " " + lblname + " " + o1v + " " + o2v;
-			out += "\ndvar " + varname + " sint:1";
-			out += "\nlabel " + lblname;
+		out.emit(opcode::dvar, { mcasm_operand::variable(varname), mcasm_operand::sint(0) });
+		auto lblname = get_next_label_name("_eval_comp");
+		out.emit(c.jump_if_false, { mcasm_operand::label_name(lblname), c.a, c.b });
+		out.emit(opcode::dvar, { mcasm_operand::variable(varname), mcasm_operand::sint(1) });
+		out.emit(opcode::label, { mcasm_operand::label_name(lblname) });
 
-			return binary_operator_result{
-				.type = outtype,
-				.src = out
-			};
-		}
-		else {
-			if (o1.get_type() != o2.get_type()) {
-				// try to convert o1's type to o2's type
-				auto attempt = implicit_convert_to_type("DONOTUSE", o1.get_type(), o2.get_type());
-				if (attempt.has_value()) {
-					auto pair = o1.retrieve_asm_value_copy(); // need a copy bc we're casting
-					o1v = pair.second;
-					get_o1v_src = pair.first + *implicit_convert_to_type(o1v, o1.get_type(), o2.get_type());
-				}
-				else {
-					// try to convert o2's type to o1's type
-					auto attempt = implicit_convert_to_type("DONOTUSE", o2.get_type(), o1.get_type());
-					if (attempt.has_value()) {
-						auto pair = o2.retrieve_asm_value_copy(); // need a copy bc we're casting
-						o2v = pair.second;
-						get_o2v_src = pair.first + *implicit_convert_to_type(o2v, o2.get_type(), o1.get_type());
-					}
-					else {
-						throw std::runtime_error("incompatible operands");
-					}
-				}
-			}
+		return mcasm_operand::value_of(varname);
+	}, .jump_if_false = std::pair(intinstruction, dblinstruction) };
+}
 
-			// symbol cast and comparison
-			out += get_o1v_src;
-			out += get_o2v_src;
-			out += "\n" + intinstruction + " " + lblname + " " + o1v + " " + o2v;
-			out += "\ndvar " + varname + " sint:1";
-			out += "\nlabel " + lblname;
+// result_type of make_reference_comparison_operator's operators
+std::function<type_info_(operand&, operand&)> make_reference_comparison_type() {
+	return [](operand& o1, operand& o2) -> type_info_ {
+		if (!o1.get_type()->pass_by_reference || !o2.get_type()->pass_by_reference) {
+			throw std::runtime_error("&== and &!= only work between two reference types.");
 		}
-
-		assert(false);
+		return bool_type;
 	};
 }
 
-std::function <binary_operator_result(std::string, operand&, operand&)> make_reference_comparison_operator(std::string intinstruction) {
-	return [intinstruction](std::string vaname, operand& o1, operand& o2) -> binary_operator_result {
+std::function<mcasm_operand(symbol_id, operand&, operand&)> make_reference_comparison_operator(opcode intinstruction) {
+	return [intinstruction](symbol_id vaname, operand& o1, operand& o2) -> mcasm_operand {
 		if (!o1.get_type()->pass_by_reference || !o2.get_type()->pass_by_reference) {
 			throw std::runtime_error("&== and &!= only work between two reference types.");
 		}
@@ -773,107 +756,179 @@ std::function <binary_operator_result(std::string, operand&, operand&)> make_ref
 		assert(dynamic_cast<varname*>(&o2) != nullptr && dynamic_cast<varname*>(&o2)->symname != COMPILER_TEMP_NAME);
 		// TODO: handling different reference types at compile time would probably be nice
 
-		std::string out;
-		auto [src1, v1] = o1.retrieve_asm_value();
-		auto [src2, v2] = o2.retrieve_asm_value();
-
-		out += src1 + src2;
-		std::string adr1 = get_next_assembly_name(), adr2 = get_next_assembly_name(), compresult = get_next_assembly_name();
-		out += "\ndvar " + adr1 + " sint:0 ; &" + dynamic_cast<varname*>(&o1)->symname;
-		out += "\nusym2s " + v1 + " " + adr1;
-		out += "\ndvar " + adr2 + " sint:0 ; &" + dynamic_cast<varname*>(&o1)->symname;
-		out += "\nusym2s " + v2 + " " + adr2;
-
-		std::string lblname = get_next_label_name();
-		out += "\ndvar " + compresult + " sint:0 ; adr comp";
-		out += "\n" + intinstruction + " " + lblname + " " + adr1 + " " + adr2;
-		out += "\ndvar " + vaname + " sint:1";
-		out += "\nlabel " + lblname;
-
-		return binary_operator_result{
-			.type = bool_type,
-			.src = out
-		};
+		auto v1 = o1.retrieve_asm_value();
+		auto v2 = o2.retrieve_asm_value();
+
+		auto adr1 = get_next_assembly_name(), adr2 = get_next_assembly_name(), compresult = get_next_assembly_name();
+		out.emit(opcode::dvar, { mcasm_operand::variable(adr1), mcasm_operand::sint(0) }, interner.intern("&" + dynamic_cast<varname*>(&o1)->symname));
+		out.emit(opcode::sym2s, { v1.as_variable(), mcasm_operand::variable(adr1) });
+		out.emit(opcode::dvar, { mcasm_operand::variable(adr2), mcasm_operand::sint(0) }, interner.intern("&" + dynamic_cast<varname*>(&o2)->symname));
+		out.emit(opcode::sym2s, { v2.as_variable(), mcasm_operand::variable(adr2) });
+
+		auto lblname = get_next_label_name();
+		out.emit(opcode::dvar, { mcasm_operand::variable(compresult), mcasm_operand::sint(0) }, interner.intern("adr comp"));
+		out.emit(intinstruction, { mcasm_operand::label_name(lblname), mcasm_operand::value_of(adr1), mcasm_operand::value_of(adr2) });
+		out.emit(opcode::dvar, { mcasm_operand::variable(vaname), mcasm_operand::sint(1) });
+		out.emit(opcode::label, { mcasm_operand::label_name(lblname) });
+
+		return mcasm_operand::value_of(vaname);
 	};
 }
 
-std::unordered_map<std::string, binary_operator> // see https://en.cppreference.com/w/cpp/language/operator_precedence
-binary_operators = {
+// result_type of && and ||
+static type_info_ logical_type(operand& o1, operand& o2) {
+	if (o1.get_referenceless_type() != bool_type || o2.get_referenceless_type() != bool_type) throw std::runtime_error("incompatible operands");
+	return bool_type;
+}
+
+// && and ||, which only evaluate their right side if the left one doesn't decide the result.
+// they're branched on the same way conditions are (see branch_if), so a comparison or another && or || inside them doesn't get put in a bool either.
+binary_operator make_logical_operator(int priority, operator_id op) {
+	return binary_operator{ .priority = priority, .result_type = logical_type, .func = [op](symbol_id varname, operand& o1, operand& o2) {
+		// (varname is already 0)
+		auto false_label = get_next_label_name("_eval_logic");
+		if (op == operator_id::logical_and) {
+			branch_if(o1, false, false_label);
+			branch_if(o2, false, false_label);
+			out.emit(opcode::dvar, { mcasm_operand::variable(varname), mcasm_operand::sint(1) });
+		}
+		else {
+			auto true_label = get_next_label_name("_eval_logic");
+			branch_if(o1, true, true_label);
+			branch_if(o2, false, false_label);
+			out.emit(opcode::label, { mcasm_operand::label_name(true_label) });
+			out.emit(opcode::dvar, { mcasm_operand::variable(varname), mcasm_operand::sint(1) });
+		}
+		out.emit(opcode::label, { mcasm_operand::label_name(false_label) });
+		return mcasm_operand::value_of(varname);
+	}, .evaluates_operands = false };
+}
+
+const auto unary_operators = make_operator_table<unary_operator>({
+	//{operator_id::subtract, operator_ {.unary = true}},
+	{operator_id::logical_not, unary_operator {.priority = 70, .result_type = [](operand& o) -> type_info_ {
+		if (o.get_referenceless_type() != bool_type) throw std::runtime_error("incompatible operand");
+		return bool_type;
+	}, .func = [](symbol_id varname, operand& o) -> mcasm_operand {
+		auto v = o.retrieve_asm_value();
+		if (v.kind == mcasm_operand::kind_t::sint) return mcasm_operand::sint(v.int_value == 0);
+
+		// (varname is already 0)
+		auto lblname = get_next_label_name("_eval_not");
+		out.emit(opcode::sjne, { mcasm_operand::label_name(lblname), v, mcasm_operand::sint(0) });
+		out.emit(opcode::dvar, { mcasm_operand::variable(varname), mcasm_operand::sint(1) });
+		out.emit(opcode::label, { mcasm_operand::label_name(lblname) });
+		return mcasm_operand::value_of(varname);
+	}}}
+});
 
-	{".", binary_operator {.priority = 80}},
+// see https://en.cppreference.com/w/cpp/language/operator_precedence
+const auto binary_operators = make_operator_table<binary_operator>({
 
-	{"*", binary_operator {.priority = 70, .func = make_math_func("dmul", "smul")}},
-	{"/", binary_operator {.priority = 70, .func = make_math_func("ddiv", "sdiv", false, 2)}},
-	{"%", binary_operator {.priority = 70, .func = make_math_func("ddiv", "sdiv", false, 1)}},
+	{operator_id::member_access, binary_operator {.priority = 80}},
 
-	{"+", binary_operator {.priority = 60, .func = make_math_func("dadd", "sadd")}},
-	{"-", binary_operator {.priority = 60, .func = make_math_func("dsub", "ssub")}},
+	{operator_id::multiply, binary_operator {.priority = 70, .result_type = make_math_type(), .func = make_math_func(opcode::dmul, opcode::smul)}},
+	{operator_id::divide, binary_operator {.priority = 70, .result_type = make_math_type(), .func = make_math_func(opcode::ddiv, opcode::sdiv, false, 2)}},
+	{operator_id::modulo, binary_operator {.priority = 70, .result_type = make_math_type(), .func = make_math_func(opcode::ddiv, opcode::sdiv, false, 1)}},
 
-	{">=", binary_operator {.priority = 50, .func = make_comparison_operator("sjl", "dgl")}},
-	{"<=", binary_operator {.priority = 50, .func = make_comparison_operator("sjg", "djg")}},
-	{"<", binary_operator {.priority = 50, .func = make_comparison_operator("sjge", "djge")}},
-	{">", binary_operator {.priority = 50, .func = make_comparison_operator("sjle", "djle")}},
+	{operator_id::add, binary_operator {.priority = 60, .result_type = make_math_type(), .func = make_math_func(opcode::dadd, opcode::sadd)}},
+	{operator_id::subtract, binary_operator {.priority = 60, .result_type = make_math_type(), .func = make_math_func(opcode::dsub, opcode::ssub)}},
 
-	{"==", binary_operator {.priority = 40, .func = make_comparison_operator("sjne", "djne")}},
-	{"!=", binary_operator {.priority = 40, .func = make_comparison_operator("sje", "dje")}},
-	{"&==", binary_operator {.priority = 40, .func = make_reference_comparison_operator("sjne")}},
-	{"&!=", binary_operator {.priority = 40, .func = make_reference_comparison_operator("sje")}},
+	{operator_id::greater_equal, make_comparison_operator(50, opcode::sjl, opcode::djl)},
+	{operator_id::less_equal, make_comparison_operator(50, opcode::sjg, opcode::djg)},
+	{operator_id::less, make_comparison_operator(50, opcode::sjge, opcode::djge)},
+	{operator_id::greater, make_comparison_operator(50, opcode::sjle, opcode::djle)},
 
-	{"&&", binary_operator {.priority = 30}},
+	{operator_id::equal, make_comparison_operator(40, opcode::sjne, opcode::djne)},
+	{operator_id::not_equal, make_comparison_operator(40, opcode::sje, opcode::dje)},
+	{operator_id::reference_equal, binary_operator {.priority = 40, .result_type = make_reference_comparison_type(), .func = make_reference_comparison_operator(opcode::sjne)}},
+	{operator_id::reference_not_equal, binary_operator {.priority = 40, .result_type = make_reference_comparison_type(), .func = make_reference_comparison_operator(opcode::sje)}},
 
-	{"||", binary_operator {.priority = 20}},
+	{operator_id::logical_and, make_logical_operator(30, operator_id::logical_and)},
+
+	{operator_id::logical_or, make_logical_operator(20, operator_id::logical_or)},
+
+	{operator_id::assign, binary_operator {.a = right_to_left, .priority = 10, .result_type = [](operand& o1, operand& o2) -> type_info_ {
+		if (dynamic_cast<varname*>(&o1) == nullptr || dynamic_cast<varname*>(&o1)->symname == COMPILER_TEMP_NAME) {
+			throw std::runtime_error("attempt to assign to non-variable");
+		}
 
-	{"=", binary_operator {.a = right_to_left, .priority = 10, .func = [](std::string asm_varname, operand& o1, operand& o2) -> binary_operator_result {
+		auto t1 = o1.get_type();
+		if (t1->pass_by_reference) {
+			if (dynamic_cast<varname*>(&o2) == nullptr || dynamic_cast<varname*>(&o2)->symname == COMPILER_TEMP_NAME) {
+				throw std::runtime_error("attempt to make operand refer to non-variable");
+			}
+			if (t1 != o2.get_reference_type()) {
+				throw std::runtime_error("a variable of type " + t1->name + " cannot store a value of type " + o2.get_reference_type()->name);
+			}
+			return o1.get_referenceless_type();
+		}
+		else {
+			if (!can_implicitly_convert(o2.get_referenceless_type(), t1)) {
+				throw std::runtime_error("incompatible operands for assignment");
+			}
+			return o1.get_reference_type();
+		}
+	}, .func = [](symbol_id asm_varname, operand& o1, operand& o2) -> mcasm_operand {
 
 		if (dynamic_cast<varname*>(&o1) == nullptr || dynamic_cast<varname*>(&o1)->symname == COMPILER_TEMP_NAME) {
 			throw std::runtime_error("attempt to assign to non-variable");
 		}
 
 		auto t1 = o1.get_type();
-		auto t2 = o2.get_type();
+		auto t2 = o2.get_referenceless_type(); // (it's copied)
 		if (t1->pass_by_reference) { // then make o1 refer to o2 (and make the expression evaluate to a reference to o1)
 			if (dynamic_cast<varname*>(&o2) == nullptr || dynamic_cast<varname*>(&o2)->symname == COMPILER_TEMP_NAME) {
 				throw std::runtime_error("attempt to make operand refer to non-variable");
 			}
 			if (t1 == o2.get_reference_type()) {
+				auto o2v = o2.retrieve_asm_value();
+				auto o1v = o1.retrieve_asm_value();
 
-				auto [ret_o2_code, ret_o2_varname] = o2.retrieve_asm_value();
-				auto [ret_o1_code, ret_o1_varname] = o1.retrieve_asm_value();
-
-				return binary_operator_result{
-					.type = o1.get_referenceless_type(),
-					.src = ret_o1_code + ret_o2_code + "\ndvar " + ret_o1_varname + " " + ret_o2_varname + "\ndvar " + asm_varname + " " + ret_o1_varname
-				};
+				out.emit(opcode::dvar, { o1v.as_variable(), o2v });
+				out.emit(opcode::dvar, { mcasm_operand::variable(asm_varname), o1v });
+				return mcasm_operand::value_of(asm_varname);
 			}
 			else {
 				throw std::runtime_error("a variable of type " + t1->name + " cannot store a value of type " + o2.get_reference_type()->name);
 			}
 		}
 		else { // make o1 refer to a copy of o2 (and make the expression evaluate to a reference to o1)
-			auto [ret_o2_code, ret_o2_varname] = o2.retrieve_asm_value_copy();
-			auto [ret_o1_code, ret_o1_varname] = o1.retrieve_asm_value();
-
-			auto conv_code = implicit_convert_to_type(ret_o2_varname, t2, t1);
+			auto o2v = o2.retrieve_asm_value_copy();
+			auto o1v = o1.retrieve_asm_value();
 
-			if (!conv_code.has_value()) {
+			auto converted = implicit_convert_to_type(o2v, t2, t1);
+			if (!converted.has_value()) {
 				throw std::runtime_error("incompatible operands for assignment");
 			}
-			ret_o2_code += *conv_code;
 
-			return binary_operator_result{
-					.type = o1.get_reference_type(),
-					.src = ret_o1_code + ret_o2_code + "\ndvar " + ret_o1_varname + " " + ret_o2_varname + "\ndvar " + asm_varname + " " + ret_o1_varname
-			};
+			out.emit(opcode::dvar, { o1v.as_variable(), *converted });
+			out.emit(opcode::dvar, { mcasm_operand::variable(asm_varname), o1v });
+			return mcasm_operand::value_of(asm_varname);
 		}
 },
 
 }},
-	{"+=", binary_operator {.a = right_to_left, .priority = 10, .func = make_math_func("dadd", "sadd", true)}},
-	{"-=", binary_operator {.a = right_to_left, .priority = 10, .func = make_math_func("dsub", "ssub", true)}},
-	{"*=", binary_operator {.a = right_to_left, .priority = 10, .func = make_math_func("dmul", "smul", true)}},
-	{"/=", binary_operator {.a = right_to_left, .priority = 10, .func = make_math_func("dsub", "ssub", true, 2)}},
-	{"%=", binary_operator {.a = right_to_left, .priority = 10, .func = make_math_func("dsub", "ssub", true, 1)}},
-};
+	{operator_id::add_assign, binary_operator {.a = right_to_left, .priority = 10, .result_type = make_math_type(true), .func = make_math_func(opcode::dadd, opcode::sadd, true)}},
+	{operator_id::subtract_assign, binary_operator {.a = right_to_left, .priority = 10, .result_type = make_math_type(true), .func = make_math_func(opcode::dsub, opcode::ssub, true)}},
+	{operator_id::multiply_assign, binary_operator {.a = right_to_left, .priority = 10, .result_type = make_math_type(true), .func = make_math_func(opcode::dmul, opcode::smul, true)}},
+	{operator_id::divide_assign, binary_operator {.a = right_to_left, .priority = 10, .result_type = make_math_type(true), .func = make_math_func(opcode::ddiv, opcode::sdiv, true, 2)}},
+	{operator_id::modulo_assign, binary_operator {.a = right_to_left, .priority = 10, .result_type = make_math_type(true), .func = make_math_func(opcode::ddiv, opcode::sdiv, true, 1)}},
+});
+
+// nullptr if the token isn't a binary operator
+const binary_operator* find_binary_operator(const token& t) {
+	if (!t.is(token_kind::operator_)) return nullptr;
+	auto& op = binary_operators[static_cast<size_t>(t.op)];
+	return op.priority != 0 ? &op : nullptr;
+}
+
+// nullptr if the token isn't a unary operator
+const unary_operator* find_unary_operator(const token& t) {
+	if (!t.is(token_kind::operator_)) return nullptr;
+	auto& op = unary_operators[static_cast<size_t>(t.op)];
+	return op.priority != 0 ? &op : nullptr;
+}
 //std::unordered_map<std::string, operator_> post_operators{
 //	{"(", operator_ {.unary = true, .priority = 120} }, // function call
 //	{"[", operator_ {.unary = true, .priority = 120} }, // subscript
@@ -881,332 +936,150 @@ binary_operators = {
 //}
 
 
-void return_token(std::string token) {
-	// add backwards
-	std::reverse(token.begin(), token.end());
-	src += token;
-	if (token == "\n") tokenizer.current_line_number--;
+
+std::unordered_map<symbol_id, std::string> symbol_to_assembly_names; // key is a function or variable name in user program. value is corresponding name 
+int i = 0;
+symbol_id get_next_assembly_name(std::string_view suffix) {
+	return interner.intern("v" + std::to_string(i++) + std::string(suffix));
 }
 
+// an operator applied to operands, the inner nodes of an expression's tree
+class operation : public operand {
+public:
+	type_info_ type = nullptr; // set by infer_types
+	varname result = varname(no_symbol, nullptr); // the variable the value was put in when it was generated
+	literal constant = literal(nullptr, ""); // or the value itself, if it was known at compile time
+	bool is_constant = false;
+
+	// remembers where generating it put the value, for evaluate_operand
+	void set_value(mcasm_operand value) {
+		is_constant = value.is_immediate();
+		if (value.kind == mcasm_operand::kind_t::sint) constant = literal(type, "", value.int_value);
+		else if (value.kind == mcasm_operand::kind_t::dbl) constant = literal(type, "", 0, value.float_value);
+		else result = varname(value.as_variable().name, type);
+	}
 
+	mcasm_operand retrieve_asm_value_copy() override {
+		auto name = get_next_assembly_name("_copy");
+		copy(name, retrieve_asm_value());
+		return mcasm_operand::value_of(name);
+	}
 
-std::string get_next_token() {
+	type_info_ get_type() override {
+		assert(type); // infer_types has to have run
+		return type;
+	}
+};
 
-	std::string token = "";
-	bool escape_next_char = false;
-	int is_number = -1; // 0 if no, 1 if left side of decimal point, 2 if right side of decimal point
-	constexpr int NONE = -10000;
+// operators look at their operands as many times as they like (to get their types, to copy them...), so anything that generates code is generated once into a variable first and the operator gets that variable instead.
+// storage is where to keep the variable if o isn't an operation (which has its own).
+static operand* evaluate_operand(operand* o, varname& storage) {
+	if (auto o_operation = dynamic_cast<operation*>(o)) {
+		o_operation->retrieve_asm_value();
+		return o_operation->is_constant ? static_cast<operand*>(&o_operation->constant) : &o_operation->result;
+	}
+	if (dynamic_cast<varname*>(o) || dynamic_cast<literal*>(o)) return o; // (nothing to generate)
 
-	bool in_string_literal = false;
-	bool in_long_comment = false;
-	bool in_line_comment = false;
+	auto location = o->retrieve_asm_value();
+	if (location.name == return_asmvar) { // the next call would overwrite it
+		auto name = get_next_assembly_name();
+		copy(name, location);
+		location = mcasm_operand::value_of(name);
+	}
+	storage = varname(location.as_variable().name, o->get_type());
+	return &storage;
+}
 
-	int last_char = NONE;
-	while (src.size() > 0) {
-		char c = src.back();
-		src.pop_back();
+class binary_operation : public operation {
+public:
+	operator_id op;
+	operand* lhs;
+	operand* rhs;
+	varname lhs_value = varname(no_symbol, nullptr), rhs_value = varname(no_symbol, nullptr); // see evaluate_operand
+
+	binary_operation(operator_id o, operand* l, operand* r) : op(o), lhs(l), rhs(r) {}
+
+	mcasm_operand retrieve_asm_value() override {
+		auto& operator_ = binary_operators[static_cast<size_t>(op)];
+		auto o1 = lhs, o2 = rhs;
+		if (operator_.evaluates_operands) {
+			o1 = evaluate_operand(lhs, lhs_value);
+			o2 = evaluate_operand(rhs, rhs_value);
+		}
+		auto tempasmname = get_next_assembly_name();
+
+		// gotta predefine declare tempasmname
+		auto mark = out.code.size();
+		out.emit(opcode::dvar, { mcasm_operand::variable(tempasmname), mcasm_operand::sint(0) });
+
+		auto value = operator_.func(tempasmname, *o1, *o2);
+		if (value.kind != mcasm_operand::kind_t::symbol || value.name != tempasmname) out.code.resize(mark); // (the operator didn't need it after all)
+		set_value(value);
+		return value;
+	}
+};
 
-		if (last_char == NONE) {
-			is_number = std::isdigit(c) ? 1 : 0;
-			if (c == '-') {
-				char next = src.back();
-				if (std::isdigit(next)) is_number = 1;
-			}
-		}
+class unary_operation : public operation {
+public:
+	operator_id op;
+	operand* value;
+	varname value_value = varname(no_symbol, nullptr); // see evaluate_operand
 
-		if (c == '\n') tokenizer.current_line_number++;
-		
-		if (is_number != 0 && !(c == '-' || c == '.' || std::isdigit(c))) { // then this number has ended
-			src.push_back(c);
-			break;
-		}
+	unary_operation(operator_id o, operand* v) : op(o), value(v) {}
 
-		if (in_string_literal) {
-			if (c == '\\' && !escape_next_char) {
-				escape_next_char = true;
-			}
-			else {
-				token += c;
+	mcasm_operand retrieve_asm_value() override {
+		auto o = evaluate_operand(value, value_value);
+		auto tempasmname = get_next_assembly_name();
 
-				if (c == '\"' && !escape_next_char) {
-					in_string_literal = false;
-					break;
-				}
-			}
-		}
-		else if (in_line_comment) {
-			if (c == '\n') {
-				//src.push_back(c);
-				token += {'\n'};
-				break;
-			}
-		}
-		else if (in_long_comment) {
-			if (c == '/' && last_char == '*')
-				in_long_comment = false;
+		auto mark = out.code.size();
+		out.emit(opcode::dvar, { mcasm_operand::variable(tempasmname), mcasm_operand::sint(0) });
 
-		}
-		else if (c == '\"' && !in_string_literal) {
-			if (token.empty()) {
-				token += { c };
-				in_string_literal = true;
-			}
-			else {
-				src.push_back(c);
-				break;
-			}
-		}
-		else if (c == '/' && last_char == '/') {
-			in_line_comment = true;
-			// remove the first slash from the token
-			token.pop_back();
-			last_char = NONE;
-		}
-		else if (last_char == '|') {
-			if (c == '|') {
-				token += {c};
-				break;
-			}
-			else {
-				src.push_back(c);
-				break;
-			}
-		}
-		else if (c == '&') {
-			if (parser.is_type(token)) {
-				token += { c };
-			}
-			else if (last_char == '&') {
-				token += { c };
-				break;
-			}
-			else {
-				src.push_back(c);
-				break;
-			}
-		}
-		// these characters ALWAYS form their own token. 
-		// if we already started a token with something else, return the token we already had and return this character the next time get_next_token() is called.
-		else if (std::find(ALWAYS_STANDALONE.begin(), ALWAYS_STANDALONE.end(), c) != ALWAYS_STANDALONE.end())
-			if (token.empty()) {
-				token = { c };
-				break;
-			}
-			else {
-				src.push_back(c);
-				break;
-			}
-		else if (c == '=') {
-			if (last_char == NONE) {
-				// the token might end up being ==, so keep going
-				token += { c };
-			}
-			else if ( // handle +=, -=, ==, etc.
-				last_char == '+' ||
-				last_char == '-' ||
-				last_char == '*' ||
-				last_char == '/' ||
-				last_char == '=' ||
-				last_char == '%' ||
-				last_char == '!' ||
-				last_char == '<' ||
-				last_char == '>'
-				)
-			{ 
-				token += { c };
-				break;
-			}
-			else { // this = should be part of the next token, not this one
-				src.push_back(c);
-				break;
-			}
-		}
-		// numeric literals (TODO: hexadecimal would be simple) (todo: suffixes like 3.0f?)
-		// (we don't treat it as this if it's following letters because that means they just making a symbol name like x3 or bobis32)
-		// implicitly handled, actually
-		//else if (std::isdigit(c) && !(last_char != NONE && std::isalpha(last_char))) {
-			
-			//token += c;
-		//}
-		// could be decimal point, could be member access syntax 
-		else if (c == '.') {
-			if (is_number == 2) {
-				throw std::runtime_error("malformed number");
-			}
-			else if (is_number == 1) { // add decimal to literal
-				is_number = 2;
-				token += { c };
-			}
-			else { // member access syntax, should be its own token
-				if (token.empty()) {
-					token = { c };
-					break;
-				}
-				else {
-					src.push_back(c);
-					break;
-				}
-			}
-		}
-		// handle operators that weren't +=, -=, etc.
-		else if (last_char == '+' || last_char == '-' || last_char == '*' || last_char == '/' || last_char == '%') {
-			if (c == last_char && (c == '+' || c == '-')) {
-				token += {c};
-				break;
-			}
-			else {
-				if (last_char == '-' && std::isdigit(c)) {
-					token += {c};
-				} 
-				else {
-					src.push_back(c);
-					break;
-				}
-			}
-		}
-
-		// all other tokens are just user-defined names of stuff or keywords, just add the letter and move on
-		else {
-			token += { c };
-		}
-
-		last_char = c;
-		escape_next_char = false;
+		auto result = unary_operators[static_cast<size_t>(op)].func(tempasmname, *o);
+		if (result.kind != mcasm_operand::kind_t::symbol || result.name != tempasmname) out.code.resize(mark);
+		set_value(result);
+		return result;
 	}
+};
 
-	//std::cout << "|" << token;
-	/*if (token == "class") {
-		std::cout << "";
-	}*/
-
-	return token;
-}
-
-bool is_reserved(std::string str) {
-	return str == "class" || str == "function" || str == "for" || str == "while";
-}
-
-std::unordered_map<std::string, std::string> symbol_to_assembly_names; // key is a function or variable name in user program. value is corresponding name 
-int i = 0;
-std::string get_next_assembly_name() {
-	return "v" + std::to_string(i++);
+// the type-inference pass. annotates every operation in the tree with the type of its result (children first), throwing if an operator can't take its operands.
+// runs once per expression, right after it's parsed, so nothing ever has to generate code to find out a type.
+static void infer_types(operand* o) {
+	if (auto b = dynamic_cast<binary_operation*>(o)) {
+		infer_types(b->lhs);
+		infer_types(b->rhs);
+		b->type = binary_operators[static_cast<size_t>(b->op)].result_type(*b->lhs, *b->rhs);
+	}
+	else if (auto u = dynamic_cast<unary_operation*>(o)) {
+		infer_types(u->value);
+		u->type = unary_operators[static_cast<size_t>(u->op)].result_type(*u->value);
+	}
 }
 
+// the root of an expression's tree, which is what statements hold on to
 class expression: public operand {
 public:
+	operand* root;
 
-	
-
-	using token = std::variant<binary_operator, unary_operator, std::shared_ptr<operand>>;
-	std::vector<token> tokens; 
-	type_info_ type;
-	bool sorted = false;
-	bool computed_type = false;
-
-	expression(std::vector<token> t): tokens(t) {}
-
-	// sort operands into polish postfix notation (https://en.wikipedia.org/wiki/Shunting_yard_algorithm)
-	void shunting_yard() {
-		assert(!sorted);
-		auto remaining = tokens;
-		std::vector<binary_operator> stack;
-		std::vector<token> out;
-		std::reverse(remaining.begin(), remaining.end());
-		while (!remaining.empty()) {
-			auto thing = remaining.back();
-			remaining.pop_back();
-
-			if (std::holds_alternative<unary_operator>(thing)) {
-				unary_operator op = std::get<unary_operator>(thing);
-					
-				if (remaining.empty()) throw std::runtime_error("expected symbol after unary");
-				auto next = remaining.back();
-				remaining.pop_back();
-				if (!std::holds_alternative<std::shared_ptr<operand>>(next)) throw std::runtime_error("expected symbol after unary, not operator");
-				thing = std::shared_ptr<expression>(new expression(std::vector<token>{op, next}));
-			}
-
-			if (std::holds_alternative<std::shared_ptr<operand>>(thing))
-			{
-				out.push_back(thing);
-			}
-			else {
-				while (!stack.empty()
-					&& (stack.back().priority > std::get<binary_operator>(thing).priority ||
-						(stack.back().priority == std::get<binary_operator>(thing).priority && std::get<binary_operator>(thing).a == associativity::left_to_right))) {
-					auto o = stack.back();
-					stack.pop_back();
-					out.push_back(o);
-				}
-				stack.push_back(std::get<binary_operator>(thing));
-			}
-		}
-
-
-		while (!stack.empty()) {
-			auto o = stack.back();
-			stack.pop_back();
-			out.push_back(o);
-		}
-
-		std::reverse(out.begin(), out.end());
+	expression(operand* r): root(r) {}
 
-		sorted = true;
-		tokens = out;
+	mcasm_operand retrieve_asm_value() {
+		return root->retrieve_asm_value();
 	}
 
-	std::pair<std::string, std::string> retrieve_asm_value() {
-		assert(sorted);
-		std::string out;
-		std::vector<token> mathables;
-		auto rtokens = tokens;
-		std::reverse(rtokens.begin(), rtokens.end());
-		for (auto& op : rtokens) {
-			if (std::holds_alternative<std::shared_ptr<operand>>(op)) {
-				mathables.push_back(op);
-			}
-			else {
-				assert(mathables.size() > 1);
-				auto o2 = mathables.back();
-				mathables.pop_back();
-				auto o1 = mathables.back();
-				mathables.pop_back();
-				auto tempasmname = get_next_assembly_name();
-				
-				// gotta predefine declare tempasmname
-				out += "\ndvar " + tempasmname + " sint:0";
-
-				auto subout = std::get<binary_operator>(op).func(tempasmname, *std::get<std::shared_ptr<operand>>(o1), *std::get<std::shared_ptr<operand>>(o2));
-				mathables.push_back(std::shared_ptr<operand>((operand*)(new varname(tempasmname, subout.type))));
-
-				out += subout.src;
-			}
-		}
-
-		assert(mathables.size() == 1);
-		auto [src, storedpos] = std::get<std::shared_ptr<operand>>(mathables.back())->retrieve_asm_value();
-		out += src;
-
-		type = std::get<std::shared_ptr<operand>>(mathables.back())->get_type();
-		computed_type = true;
-		return std::make_pair(out, storedpos);
-	}
-
-	std::pair < std::string, std::string> retrieve_asm_value_copy() {
-		auto name = get_next_assembly_name() + "_copy";
-		auto [src, var] = retrieve_asm_value();
-		return std::make_pair(src + copy(name, var), name);
+	mcasm_operand retrieve_asm_value_copy() {
+		auto name = get_next_assembly_name("_copy");
+		copy(name, retrieve_asm_value());
+		return mcasm_operand::value_of(name);
 	}
 
 	type_info_ get_type() override {
-		if (!computed_type) retrieve_asm_value();
-		return type;
+		return root->get_type();
 	}
 };
 
 struct object_creation_field {
 	std::string field_name;
-	std::shared_ptr<operand> field_value;
+	operand* field_value;
 };
 
 class object_creation : public operand {
@@ -1216,11 +1089,10 @@ public:
 
 	object_creation(type_info_ t, std::vector<object_creation_field> f) : object_type(t), fields(f) {}
 
-	std::pair<std::string, std::string> retrieve_asm_value() {
-		std::string code = "";
-		std::string varname = get_next_assembly_name() + "_obj";
+	mcasm_operand retrieve_asm_value() {
+		auto varname = get_next_assembly_name("_obj");
 
-		code += "\ndvar " + varname + " arr:null; construct new " + object_type->name;
+		out.emit(opcode::dvar, { mcasm_operand::variable(varname), mcasm_operand::empty_array() }, interner.intern("construct new " + object_type->name));
 		auto final_fields = fields;
 		for (auto& [name, field] : object_type->fields) {
 			for (auto& f : fields) {
@@ -1237,7 +1109,7 @@ public:
 		}
 
 		assert(final_fields.size() == object_type->fields.size());
-		std::vector<std::string> assignmentLocations;
+		std::vector<mcasm_operand> assignmentLocations;
 		assignmentLocations.resize(final_fields.size());
 		for (auto& f : final_fields) {
 			auto targetType = object_type->fields.at(f.field_name).type;
@@ -1245,32 +1117,26 @@ public:
 				if (f.field_value->get_type() != targetType && f.field_value->get_type() != null_type) { // TODO: some references can be casted into another (like null or with inheritance)
 					throw std::runtime_error("incompatible types in field assignment");
 				}
-				auto [ret_value_asm, value_loc] = f.field_value->retrieve_asm_value();
-				assignmentLocations[object_type->fields.at(f.field_name).index] = value_loc;
-				code += ret_value_asm;
+				assignmentLocations[object_type->fields.at(f.field_name).index] = f.field_value->retrieve_asm_value();
 			}
 			else {
-				auto [ret_value_asm, value_loc] = f.field_value->retrieve_asm_value_copy();
-
-				auto conv_code = implicit_convert_to_type(value_loc, f.field_value->get_type(), targetType);
+				auto converted = implicit_convert_to_type(f.field_value->retrieve_asm_value_copy(), f.field_value->get_type(), targetType);
 
-				if (!conv_code.has_value()) {
+				if (!converted.has_value()) {
 					throw std::runtime_error("incompatible operands for assignment");
 				}
-				ret_value_asm += *conv_code;
-				assignmentLocations[object_type->fields.at(f.field_name).index] = value_loc;
-				code += ret_value_asm;
+				assignmentLocations[object_type->fields.at(f.field_name).index] = *converted;
 			}	
 		}
 
-		for (int i = 0; i < assignmentLocations.size(); i++) {
-			code += "\naarr " + varname + " sym:" + assignmentLocations[i];
+		for (auto& location : assignmentLocations) {
+			out.emit(opcode::aarr, { mcasm_operand::variable(varname), location });
 		}
 
-		return std::make_pair(code, varname);
+		return mcasm_operand::value_of(varname);
 	}
 
-	std::pair<std::string, std::string> retrieve_asm_value_copy() {
+	mcasm_operand retrieve_asm_value_copy() {
 		return retrieve_asm_value();
 	}
 
@@ -1279,469 +1145,372 @@ public:
 	~object_creation() = default;
 };
 
-static std::string get_next_non_empty_token(bool allowEmpty = false);
+static token get_next_non_empty_token(bool allowEmpty = false);
 static void process_code_body();
-static std::pair<std::string, std::shared_ptr<expression>> get_next_expression();
-
-static bool equivalent_grouping(std::string a, std::string b) {
-	if (a == "(") return b == ")";
-	if (a == ")") return b == "(";
-	if (a == "]") return b == "]";
-	if (a == "[") return b == "[";
-	if (a == "{") return b == "}";
-	if (a == "}") return b == "{";
-	return false;
-}
+static expression* get_next_expression();
 
 struct variable_assignment {
 	type_info_ type; // type of the variable, not of expr
 	std::string var_name;
-	std::string asm_name; // includes sym: or sint: or whatever so don't add it
-	std::pair<std::string, std::shared_ptr<expression>> expr = {"ERROR", nullptr};
-
-	std::string get_asm() {
-		assert(expr.second != nullptr);
-
-		auto [asmcode, asmvar] = expr.second->retrieve_asm_value();
-		
-		if (expr.second->get_type() != type && expr.second->get_reference_type() != type) {
-			auto pair = expr.second->retrieve_asm_value_copy();
-			asmvar = pair.second;
-			auto code = implicit_convert_to_type(asmvar, expr.second->get_type(), type);
-			if (!code.has_value()) throw std::runtime_error("cannot assign expression of type " + expr.second->get_type()->name + " to variable of type " + type->name);
-			asmcode = pair.first + *code;
-		}
-
-		if (asmvar.find_first_of(":") == std::string::npos) asmvar = "sym:" + asmvar;
-		std::string out = asmcode + "\ndvar " + asm_name + " " + asmvar += " ;" + var_name;
-
-		return out;
+	symbol_id var_symbol = no_symbol; // interned var_name
+	symbol_id asm_name = no_symbol;
+	expression* value = nullptr;
+
+	// the statement that actually makes the variable exist
+	variable_declaration* make_declaration(int line) {
+		assert(value != nullptr);
+		return parser.nodes.make<variable_declaration>(line, type, var_name, asm_name, value);
 	}
 };
 
-static std::variant<std::pair<std::string, std::shared_ptr<expression>>, variable_assignment> get_expression_or_variable_assignment() {
-	std::string current_token = get_next_non_empty_token();
-	if (current_token == "var" || parser.is_type(current_token)) { // then we're defining a variable now.
+// the expression is nullptr if there isn't one
+static std::variant<expression*, variable_assignment> get_expression_or_variable_assignment() {
+	token current_token = get_next_non_empty_token();
+	bool is_var = current_token.is(token_kind::keyword_var);
+	if (is_var || parser.is_type(current_token.symbol)) { // then we're defining a variable now.
 
-		std::string var_name = get_next_non_empty_token();
-		if (var_name.empty() || !parser.is_valid_symbol_name(var_name))
+		token var_name = get_next_non_empty_token();
+		if (!var_name.is(token_kind::identifier) || !parser.is_valid_symbol_name(var_name.symbol))
 			throw std::runtime_error("invalid variable name");
 
-		if (get_next_non_empty_token() != "=")
+		if (!get_next_non_empty_token().is(operator_id::assign))
 			throw std::runtime_error("expected \"=\" when defining variable");
 
 		auto assignment = get_next_expression();
+		if (!assignment) throw std::runtime_error("expected value of variable \"" + std::string(var_name.text) + "\"");
 
 		return variable_assignment{
-			.type =  current_token == "var" ? assignment.second->get_type() : parser.is_type(current_token),
-			.var_name = var_name,
+			.type = is_var ? assignment->get_type() : parser.is_type(current_token.symbol),
+			.var_name = std::string(var_name.text),
+			.var_symbol = var_name.symbol,
 			.asm_name = get_next_assembly_name(),
-			.expr = assignment,
+			.value = assignment,
 		};
 	}
 	else {
-		return_token(current_token);
+		tokenizer.unget();
 		return get_next_expression();
 	}
 }
 
-static std::string get_next_non_empty_token(bool allowEof) {
-	while (true) {
-		auto token = get_next_token();
-		if (token == "")
-			if (allowEof) return "";
-			else throw std::runtime_error("unexpected eof");
-		if (token != " " && token != "\t" && token != "\n") {
-			//std::cout << "Token \"" + token + "\"\n";
-			if (token == "function") {
-				std::cout << "";
-			}
-			return token;
-		}
-
-	}
+static token get_next_non_empty_token(bool allowEof) {
+	// the tokenizer already skips whitespace and comments
+	auto t = tokenizer.next_token();
+	if (t.is(token_kind::end) && !allowEof) throw std::runtime_error("unexpected eof");
+	//std::cout << "Token \"" + t.text + "\"\n";
+	return t;
 }
 
-static std::string inspect_next_non_empty_token() {
-	std::string s = get_next_non_empty_token();
-	return_token(" " + s);
-	return s;
+// conditions of ifs and loops have to be bools
+static void check_condition(expression* condition, std::string_view what) {
+	if (!condition) throw std::runtime_error("expected " + std::string(what) + " condition");
+	if (condition->get_referenceless_type() != bool_type)
+		throw std::runtime_error(std::string(what) + " condition must be a bool, not " + condition->get_type()->name);
 }
 
 static void declare_variable(variable_assignment var) {
 	//assert(var.var_name != "joe");
-	parser.scopeStack.back().known_symbols[var.var_name] = symbol_type::variable;
-	parser.scopeStack.back().variables[var.var_name] = std::make_shared<varname>(var.asm_name, var.type, var.var_name);
+	assert(var.var_symbol != no_symbol);
+	parser.symbols.declare_variable(var.var_symbol, parser.nodes.make<varname>(var.asm_name, var.type, var.var_name));
 }
 
-// can apparently (???) return an empty expression, may throw
-static std::pair<std::string, std::shared_ptr<expression>> get_next_expression() {
-	std::string expString = "";
-	std::shared_ptr<expression> expression_parse = std::make_shared<expression>(std::vector<expression::token> {});
-	std::vector<std::string> groupingSymbolStack = {};
-	std::vector<int> last = { 0 }; // if 0, last was a binary operator (or nonexistent) so next better be a symbol, if 1, last was a symbol (so we better get a binary operand now)
-	std::vector<bool> unary = { false };
-	while (true) {
-		std::string next = get_next_non_empty_token();
-		if (next == "") {
-			if (groupingSymbolStack.empty()) {
-				return_token(next);
-				break;
-			}
-			else
-				throw std::runtime_error("unexpected <eof>");
-		}
-		else if (next == ";") {
-			if (groupingSymbolStack.empty()) {
-				return_token(next);
-				break;
-			}
-			else
-				throw std::runtime_error("unexpected \";\"");
-		}
-		else if (next == "{")
-			throw std::runtime_error("unexpected \"{\"");
-		else if (next == "(" || next == "[") {
-			if (last.back() == 0) { // then its
-				if (next == "[") throw std::runtime_error("unexpected \"[\" in expression");
-
-				auto [str, subexpression] = get_next_expression();
-				expString += str;
-				expression_parse->tokens.push_back(subexpression);
-
-				last.push_back(1);
-				unary.push_back(false);
-				/*groupingSymbolStack.push_back(next);
-				last.push_back(0);
-				unary.push_back(false);
-				expString += next;*/
-			}
-			else { // () mark a function call
-				expString += next;
-				assert(!expression_parse->tokens.empty());
-				auto function = expression_parse->tokens.back();
-				expression_parse->tokens.pop_back();
-				std::shared_ptr<funccall> call = std::make_shared<funccall>();
-				auto s = std::get<std::shared_ptr<operand>>(function)->retrieve_asm_value().second;
-				call->function = std::get<std::shared_ptr<operand>>(function);
+static operand* parse_expression(int min_priority);
 
-				while (true) {
-					auto [str, subexpression] = get_next_expression();
-					if (!str.empty()) {
-						expString += str;
+// "function <return type>(<args>) { <body> }", after the "function"
+static function_literal* parse_function_literal() {
+		token ret_type_token = get_next_non_empty_token();
+		std::string_view ret_type = ret_type_token.text;
+		
 
-						call->args.push_back(subexpression);
+		auto func = parser.nodes.make<function_literal>(get_next_assembly_name("_func"));
+		func->return_type = parser.is_type(ret_type_token.symbol);
 
-					}
+		std::vector<type_info_> argtypes;
 
-					auto subnext = get_next_non_empty_token();
-					expString += subnext;
-					if (subnext == ",") {
-						
-					}
-					else if ((subnext == ")" && next == "(") || (subnext == "]" && next == "[")) {
-						break;
-					}
-					else {
-						throw std::runtime_error("expected \",\" or closing grouping symbol, got \"" + subnext + "\".");
-					}
-				}
-				
-				expression_parse->tokens.push_back(call);
-				unary.back() = false;
-				last.back() = 1;
-				auto t_f = call->function->get_type();
-				auto arg_types = parser.extract_arguments(t_f);
-				if (arg_types.size() != call->args.size()) {
-					throw std::runtime_error(std::string("expected ") + std::to_string(arg_types.size()) + " args, got " + std::to_string(call->args.size()) + " args instead");
+		parser.push_scope(scope{ .type = scope_type::function, .should_return = true, .return_type = func->return_type, .function = func });
+		parser.taskStack.push_back(parsing_task_info{ .task = parsing_task::code_body, .line_number = tokenizer.current_line_number, .body = &func->body });
+
+		if (!func->return_type) throw std::runtime_error("unrecognized function return type \"" + std::string(ret_type) + "\"");
+		if (!get_next_non_empty_token().is(token_kind::left_paren)) throw std::runtime_error("expected \"(\" after declaring function return type");
+		int argi = 0;
+		token next_arg_token = get_next_non_empty_token();
+		std::string_view next_arg = next_arg_token.text;
+		if (!next_arg_token.is(token_kind::right_paren)) {
+			while (true) {
+				type_info_ arg_type = parser.is_type(next_arg_token.symbol);
+				if (!arg_type) throw std::runtime_error("unrecognized function argument type \"" + std::string(next_arg) + "\"");
+				argtypes.push_back(arg_type);
+
+				token arg_name_token = get_next_non_empty_token();
+				std::string_view arg_name = arg_name_token.text;
+				if (!arg_name_token.is(token_kind::identifier) || !parser.is_valid_symbol_name(arg_name_token.symbol)) throw std::runtime_error("invalid argument name " + describe(arg_name_token));
+
+				token delimiter = get_next_non_empty_token();
+				if (!delimiter.is(token_kind::right_paren) && !delimiter.is(token_kind::comma)) {
+					throw std::runtime_error("expected \"(\" or \",\" after function parameter");
 				}
-				for (int i = 0; i < arg_types.size(); i++) {
-					if (arg_types[i] != call->args[i]->get_type()) throw std::runtime_error("mismatched argument #" + std::to_string(i + 1));
+				else {
+					auto v = parser.nodes.make<varname>(interner.intern("arg" + std::to_string(argi)), arg_type, std::string(arg_name));
+					auto e = parser.nodes.make<expression>(v);
+
+					auto asm_argname = get_next_assembly_name("_farg");
+					variable_assignment assignment = {
+						.type = arg_type,
+						.var_name = std::string(arg_name),
+						.var_symbol = arg_name_token.symbol,
+						.asm_name = asm_argname,
+						.value = e
+					};
+					func->parameter_asm_names.push_back(asm_argname);
+
+					declare_variable(assignment);
+					if (delimiter.is(token_kind::right_paren))
+						break;
 				}
+				next_arg_token = get_next_non_empty_token();
+				next_arg = next_arg_token.text;
+				argi++;
 			}
 		}
-		else if (next == "}" || next == "]" || next == ")") {
-			if (groupingSymbolStack.empty()) {
-				return_token(next);
-				break;
-			}
-			else if (equivalent_grouping(groupingSymbolStack.back(), next)) {
-				assert(false);
-				/*if (last.back() == 0 || unary.back()) throw std::runtime_error(std::string("expected symbol, got \"" + next + "\""));
-				groupingSymbolStack.pop_back();
-				last.pop_back();
-				unary.pop_back();
-				last.back() = 1;
-				unary.back() = false;
-				expString += next;*/
-			}
-			else {
-				throw std::runtime_error(std::string("unexpected \"") + next + "\" to close " + groupingSymbolStack.back());
-			}
-		}
-		else if (unary_operators.contains(next)) {
-			if (unary.back()) throw std::runtime_error("unary operators cannot directly follow each other");
-			if (last.back() == 1) throw std::runtime_error("unary operator cannot follow a symbol (expected a binary operator or end of the expression)");
-			expString += next;
-			expression_parse->tokens.push_back(unary_operators[next]);
-			unary.back() = true;
-		}
-		else if (binary_operators.contains(next)) {
-			if (unary.back()) throw std::runtime_error("binary operator should not follow unary operator");
-			expString += next;
-			expression_parse->tokens.push_back(binary_operators[next]);
-			last.back() = 0;
-		}
-		else if (next == "function") {
 
-			auto ret_type = get_next_non_empty_token();
-			
-
-			auto asm_funcname = get_next_assembly_name() + "_func";
-			std::string funcdef_asm = "\n\ndfunc " + asm_funcname + " ";
+		if (!get_next_non_empty_token().is(token_kind::left_brace)) throw std::runtime_error("expected \"{\" before function body");
 
-			std::vector<type_info_> argtypes;
-			std::string func_type_wip = ret_type + "(";
+	func->type = function_type(func->return_type, argtypes);
 
-			parser.scopeStack.push_back(scope{ .type = scope_type::function, .should_return = true});
-			parser.taskStack.push_back(parsing_task_info{ .task = parsing_task::code_body, .line_number = tokenizer.current_line_number });
+	process_code_body();
+	parser.pending_functions.push_back(func);
+	return func;
+}
 
-			if (!parser.is_type(ret_type)) throw std::runtime_error("unrecognized function return type \"" + ret_type + "\"");
-			if (get_next_non_empty_token() != "(") throw std::runtime_error("expected \"(\" after declaring function return type");
-			int argi = 0;
-			std::string next_arg = get_next_non_empty_token();
-			if (next_arg != ")") {
-				while (true) {
-					func_type_wip += next_arg;
+// "<type> { <field> = <value>, ... }", after the type
+static operand* parse_object_creation(type_info_ type) {
+	if (!get_next_non_empty_token().is(token_kind::left_brace)) throw std::runtime_error("expected \"{\" after typename to construct array or class object");
 
-					if (!parser.is_type(next_arg)) throw std::runtime_error("unrecognized function argument type \"" + next_arg + "\"");
-					argtypes.push_back(parser.is_type(next_arg));
+	if (type->array) {
+		assert(false); // TODO
+	}
 
-					std::string arg_name = get_next_non_empty_token();
-					if (!parser.is_valid_symbol_name(arg_name)) throw std::runtime_error("invalid argument name \"" + arg_name + "\"");
+	std::vector<object_creation_field> fields{};
 
-					std::string delimiter = get_next_non_empty_token();
-					if (delimiter != ")" && delimiter != ",") {
-						throw std::runtime_error("expected \"(\" or \",\" after function parameter");
-					}
-					else {
-						auto v = std::make_shared<varname>("arg" + std::to_string(argi), parser.is_type(next_arg), arg_name);
-						auto e = std::make_shared<expression>(std::vector<expression::token> { v });
-
-						auto asm_argname = get_next_assembly_name() + "_farg";
-						variable_assignment assignment = {
-							.type = parser.is_type(next_arg),
-							.var_name = arg_name,
-							.asm_name = asm_argname,
-							.expr = std::make_pair(std::string("??FIJIWJI"), e)
-						};
-						funcdef_asm += asm_argname + ":sym/";
-
-						declare_variable(assignment);
-						func_type_wip += delimiter;
-						if (delimiter == ")")
-							break;
-					}
-					next_arg = get_next_non_empty_token();
-					argi++;
-				}
-			}
-			else {
-				func_type_wip += next_arg;
-			}
+	while (true) {
+		token field_name = get_next_non_empty_token();
+		if (!field_name.is(token_kind::identifier)) throw std::runtime_error("expected field name, got " + describe(field_name));
 
-			if (argi == 0) funcdef_asm += "null";
-			else funcdef_asm.pop_back();
+		if (!get_next_non_empty_token().is(operator_id::assign)) throw std::runtime_error("expected \"=\" after field name");
 
-			if (get_next_non_empty_token() != "{") throw std::runtime_error("expected \"{\" before function body");
+		auto value = get_next_expression();
+		if (!value) throw std::runtime_error("expected value of field \"" + std::string(field_name.text) + "\"");
 
-			if (last.back() == 1) throw std::runtime_error("symbol cannot follow another symbol");
-			unary.back() = false;
-			last.back() = 1;
-			expString += "<function_object>"; // TODO
-			
-			assert(parser.is_type(func_type_wip));
-			//parser.fmap[asm_funcname] = std::make_shared<function_info>(parser.is_type(ret_type), parser.is_type(func_type_wip), argtypes, asm_funcname);
-			auto func = std::make_shared<varname>(asm_funcname, parser.is_type(func_type_wip));
-			expression_parse->tokens.push_back(func); // TODO: this function is anonymous 
-
-			out += funcdef_asm;
-			process_code_body();
-			out += "\nlabel function_end_lbl";
-			out += "\nendfunc\n";
-
-		}
-		else if (parser.is_variable(next) || parser.is_literal(next) || (!expString.empty() && expString.back() == '.')) { // dot operator doesn't want a variable name/literal
-			if (last.back() == 1) throw std::runtime_error("symbol cannot follow another symbol");
-			if (is_reserved(next)) throw std::runtime_error("\"" + next + "\" is invalid in this context");
-			unary.back() = false;
-			last.back() = 1;
-			expString += next;
-			
-			if (next == "joe") {
-				std::cout << "";
-			}
+		fields.push_back(object_creation_field{ .field_name = std::string(field_name.text), .field_value = value });
 
-			if (parser.is_variable(next)) {
-				//if (!symbol_to_assembly_names.contains(next)) {
-					//auto asmname = get_next_assembly_name();
-					//symbol_to_assembly_names[next] = asmname;
-				//}
-				expression_parse->tokens.push_back(parser.get_variable(next));
-			}
-			else if (parser.is_literal(next).has_value()) {
-				expression_parse->tokens.push_back(std::make_shared<literal>(*parser.is_literal(next), next)); // TODO
-			}
-			else {
-				throw std::runtime_error("unimplemented");
-				//expression_parse.operands.push_back(liter);// TODO: how to handle dot operator?
-			}
+		auto delimiter = get_next_non_empty_token();
+		if (delimiter.is(token_kind::right_brace)) {
+			break;
 		}
-		else if ((next != "var" && parser.is_type(next)) && inspect_next_non_empty_token() == "{") { // construct class object or array type
-
-			auto type = parser.is_type(next);
+		else if (!delimiter.is(token_kind::comma)) throw std::runtime_error("expected \",\" or \"}\" after field assignment expression");
 
-			if (get_next_non_empty_token() != "{") throw std::runtime_error("expected \"{\" after typename to construct array or class object");
-
-			if (type->array) {
-				assert(false);
-				expString += "<array_object>"; // TODO 
-			}
-			else {
-				std::vector<object_creation_field> fields{};
+	}
+	return parser.nodes.make<object_creation>(type, fields);
+}
 
-				while (true) {
-					std::string field_name = get_next_non_empty_token();
+// a variable, literal, parenthesized expression, function literal or object creation. nullptr (leaving the token alone) if the next token doesn't start one
+static operand* parse_primary() {
+	token next = get_next_non_empty_token(true); // <eof> just means there's nothing here
 
-					if (get_next_non_empty_token() != "=") throw std::runtime_error("expected \"=\" after field name");
+	if (next.is(token_kind::left_paren)) {
+		auto inner = parse_expression(1);
+		if (!inner) throw std::runtime_error("expected expression after \"(\"");
+		auto close = get_next_non_empty_token();
+		if (!close.is(token_kind::right_paren)) throw std::runtime_error("expected \")\", got " + describe(close));
+		return inner;
+	}
+	else if (next.is(token_kind::left_bracket))
+		throw std::runtime_error("unexpected \"[\" in expression");
+	else if (next.is(token_kind::left_brace))
+		throw std::runtime_error("unexpected \"{\"");
+	else if (next.is(token_kind::keyword_function))
+		return parse_function_literal();
+	else if (parser.is_variable(next.symbol))
+		return parser.get_variable(next.symbol);
+	else if (next.is_literal())
+		return parser.nodes.make<literal>(next);
+	else if (parser.is_type(next.symbol) && tokenizer.peek().is(token_kind::left_brace)) // construct class object or array type
+		return parse_object_creation(parser.is_type(next.symbol));
+
+	tokenizer.unget();
+	return nullptr;
+}
 
-					auto expr = get_next_expression();
-					assert(expr.second != nullptr);
+// a primary followed by any number of calls, "f(a, b)" (or "f[a, b]", which is also a call for now)
+static operand* parse_postfix() {
+	operand* value = parse_primary();
+	if (!value) return nullptr;
 
-					fields.push_back(object_creation_field{ .field_name = field_name, .field_value = expr.second });
+	while (tokenizer.peek().is(token_kind::left_paren) || tokenizer.peek().is(token_kind::left_bracket)) {
+		token_kind close = get_next_non_empty_token().is(token_kind::left_paren) ? token_kind::right_paren : token_kind::right_bracket;
+		funccall* call = parser.nodes.make<funccall>();
+		call->function = value;
 
-					auto delimiter = get_next_non_empty_token();
-					if (delimiter == "}") {
-						break;
-					}
-					else if (delimiter != ",") throw std::runtime_error("expected \",\" or \"}\" after field assignment expression");
+		while (true) {
+			if (auto arg = get_next_expression()) call->args.push_back(arg);
 
-				}
-				expression_parse->tokens.push_back(std::make_shared<object_creation>(type, fields));
-				expString += "<class_pbject>"; // TODO 
-			}
+			auto subnext = get_next_non_empty_token();
+			if (subnext.is(close)) break;
+			else if (!subnext.is(token_kind::comma)) throw std::runtime_error("expected \",\" or closing grouping symbol, got " + describe(subnext) + ".");
+		}
 
-			if (last.back() == 1) throw std::runtime_error("symbol (created object or array) cannot follow another symbol");
-			unary.back() = false;
-			last.back() = 1;
-			
-			
+		call->get_type(); // (makes sure it's a function)
+		auto& arg_types = call->function->get_type()->argument_types;
+		if (arg_types.size() != call->args.size()) {
+			throw std::runtime_error(std::string("expected ") + std::to_string(arg_types.size()) + " args, got " + std::to_string(call->args.size()) + " args instead");
 		}
-		else {
-			// they gave something that doesn't go in the expression; if the expression is done that's fine, if it's not then we error
-			if (groupingSymbolStack.empty() && !unary.back() && last.back() == 1) {
-				return_token(next);
-				break;
-			}
-			else {
-				throw std::runtime_error(std::string("unexpected \"") + next + "\"");
-			}
+		for (int i = 0; i < arg_types.size(); i++) {
+			if (arg_types[i] != call->args[i]->get_type()) throw std::runtime_error("mismatched argument #" + std::to_string(i + 1));
 		}
+		value = call;
 	}
+	return value;
+}
 
-	expression_parse->shunting_yard();
-	return std::make_pair(expString, expression_parse);
-	};
+static operand* parse_unary() {
+	if (find_unary_operator(tokenizer.peek())) {
+		token op = get_next_non_empty_token();
+		if (find_unary_operator(tokenizer.peek())) throw std::runtime_error("unary operators cannot directly follow each other");
+		if (find_binary_operator(tokenizer.peek())) throw std::runtime_error("binary operator should not follow unary operator");
+
+		auto value = parse_postfix();
+		if (!value) throw std::runtime_error("expected symbol after " + describe(op));
+		return parser.nodes.make<unary_operation>(op.op, value);
+	}
+	return parse_postfix();
+}
+
+// precedence climbing (https://en.wikipedia.org/wiki/Operator-precedence_parser#Precedence_climbing_method): only takes binary operators with at least min_priority, tighter ones end up deeper in the tree.
+// nullptr if there's no expression here at all
+static operand* parse_expression(int min_priority) {
+	operand* lhs = parse_unary();
+	if (!lhs) return nullptr;
+
+	while (true) {
+		auto op = find_binary_operator(tokenizer.peek());
+		if (!op || op->priority < min_priority) break;
+
+		token op_token = get_next_non_empty_token();
+		if (op_token.op == operator_id::member_access) throw std::runtime_error("unimplemented"); // TODO: how to handle dot operator?
+
+		// the right side of a left to right operator can't contain another one of the same priority, that one applies to this whole thing instead
+		auto rhs = parse_expression(op->a == associativity::left_to_right ? op->priority + 1 : op->priority);
+		if (!rhs) throw std::runtime_error("expected symbol after " + describe(op_token));
+
+		lhs = parser.nodes.make<binary_operation>(op_token.op, lhs, rhs);
+	}
+	return lhs;
+}
+
+// returns nullptr if there's no expression here (like in "f()"), may throw
+static expression* get_next_expression() {
+	auto root = parse_expression(1);
+	if (!root) return nullptr;
+	infer_types(root);
+
+	const token& next = tokenizer.peek();
+	if (parser.is_variable(next.symbol) || next.is_literal()) throw std::runtime_error("symbol cannot follow another symbol");
+
+	return parser.nodes.make<expression>(root);
+}
 
 // IGNORES SCOPE, THAT'S YOUR JOB
 static void process_class_body(type_info_ class_type, type_info_ class_ref_type) {
 	int i = parser.taskStack.size();
 	std::cout << "processing class block\n";
-	std::string current_token;
+	token current_token;
 	while (parser.taskStack.size() >= i) {
 		assert(parser.taskStack[i - 1].task == parsing_task::class_body);
 
-		if ((current_token = get_next_non_empty_token()) == "") {
+		if ((current_token = get_next_non_empty_token()).is(token_kind::end)) {
 			throw std::runtime_error("expected member declaration or \"}\", got <eof>");
 			// program ended
 		}
 
 		// TODO: class bodies only have member declarations, no constructors
-		if (current_token == "}") { // end class body
+		if (current_token.is(token_kind::right_brace)) { // end class body
 			parser.taskStack.pop_back();
 		}
-		else if (current_token == "var" || parser.is_type(current_token)) { // then we're defining a class field now.
+		else if (current_token.is(token_kind::keyword_var) || parser.is_type(current_token.symbol)) { // then we're defining a class field now.
+			bool is_var = current_token.is(token_kind::keyword_var);
+			auto field_type = is_var ? nullptr : parser.is_type(current_token.symbol);
 
 			// check if we're defining a function type
-			std::string isParen = get_next_non_empty_token();
-			if (isParen == "(") {
-				if (current_token == "var") throw std::runtime_error("function type cannot have \"var\" as a return type");
-				current_token += "(";
+			token isParen = get_next_non_empty_token();
+			if (isParen.is(token_kind::left_paren)) {
+				if (is_var) throw std::runtime_error("function type cannot have \"var\" as a return type");
 				// then this is hopefully a function type
+				std::vector<type_info_> argument_types;
 				while (true) {
-					std::string next_arg = get_next_non_empty_token();
+					token next_arg_token = get_next_non_empty_token();
+					std::string_view next_arg = next_arg_token.text;
 
-					if (!parser.is_type(next_arg)) throw std::runtime_error("unrecognized function argument type \"" + next_arg + "\"");
-					current_token += next_arg;
+					type_info_ arg_type = parser.is_type(next_arg_token.symbol);
+					if (!arg_type) throw std::runtime_error("unrecognized function argument type \"" + std::string(next_arg) + "\"");
+					argument_types.push_back(arg_type);
 
 					// the type of the function obviously doesn't have argument names
 					// 
-					//std::string arg_name = get_next_non_empty_token();
+					//std::string_view arg_name = get_next_non_empty_token();
 					//if (!parser.is_valid_symbol_name(arg_name)) throw std::runtime_error("invalid argument name \"" + arg_name + "\"");
 					//current_token += arg_name;
 
-					std::string delimiter = get_next_non_empty_token();
-					if (delimiter != ")" && delimiter != ",") {
+					token delimiter = get_next_non_empty_token();
+					if (!delimiter.is(token_kind::right_paren) && !delimiter.is(token_kind::comma)) {
 						throw std::runtime_error("expected \"(\" or \",\" after function parameter");
 					}
 					else {
-						current_token += delimiter;
 						//parser.scopeStack.back().known_symbols[arg_name] = symbol_type::variable;
-						if (delimiter == ")")
+						if (delimiter.is(token_kind::right_paren))
 							break;
 					}
 				}
 
-				if (!parser.is_type(current_token)) throw std::runtime_error("invalid function signature for field type");
+				field_type = function_type(field_type, argument_types);
 			}
 
-			auto field_type = current_token == "var" ? nullptr : parser.is_type(current_token);
-
-			std::string var_name = isParen == "(" ? get_next_non_empty_token() : isParen;
-			if (var_name.empty() || !parser.is_valid_symbol_name(var_name)) // TODO: naming should be more lax here
+			token var_name_token = isParen.is(token_kind::left_paren) ? get_next_non_empty_token() : isParen;
+			std::string var_name(var_name_token.text);
+			if (!var_name_token.is(token_kind::identifier) || !parser.is_valid_symbol_name(var_name_token.symbol)) // TODO: naming should be more lax here
 				throw std::runtime_error("invalid variable name");
 
 
-			std::shared_ptr<operand> default_value_expression;
+			operand* default_value_expression;
 
 			auto maybeEquals = get_next_non_empty_token();
-			if (maybeEquals != "=") { // then that's fine; we'll give our own default value
-				return_token(maybeEquals);
-				if (current_token == "var") // then that's not okay because we don't know the type of the field
+			if (!maybeEquals.is(operator_id::assign)) { // then that's fine; we'll give our own default value
+				tokenizer.unget();
+				if (is_var) // then that's not okay because we don't know the type of the field
 					throw std::runtime_error("cannot deduce field type without default value expression");
 
 				if (field_type->pass_by_reference) {
-					default_value_expression = std::make_shared<literal>(null_type, "null");
+					default_value_expression = parser.nodes.make<literal>(null_type, "null");
 				}
 				else if (field_type == i32_type) {
-					default_value_expression = std::make_shared<literal>(i32_type, "0");
+					default_value_expression = parser.nodes.make<literal>(i32_type, "0", 0);
 				}
 				else if (field_type == bool_type) {
-					default_value_expression = std::make_shared<literal>(bool_type, "false");
+					default_value_expression = parser.nodes.make<literal>(bool_type, "false", 0);
 				}
 				else if (field_type == f64_type) {
-					default_value_expression = std::make_shared<literal>(i32_type, "0.0");
+					default_value_expression = parser.nodes.make<literal>(f64_type, "0.0", 0, 0.0);
 				}
 				else if (field_type == string_type) {
-					default_value_expression = std::make_shared<literal>(string_type, "");
+					default_value_expression = parser.nodes.make<literal>(string_type, "");
 				}
 				else {
 					throw std::runtime_error("cannot automatically create default value for field \"" + var_name + "\"");
 				}
 			}
 			else {
-				default_value_expression = get_next_expression().second;
-				if (current_token == "var")
+				default_value_expression = get_next_expression();
+				if (!default_value_expression) throw std::runtime_error("expected default value of field \"" + var_name + "\"");
+				if (is_var)
 					field_type = default_value_expression->get_type();
 
 			}
@@ -1751,9 +1520,9 @@ static void process_class_body(type_info_ class_type, type_info_ class_ref_type)
 			int i = class_type->fields.size();
 			class_type->fields[var_name] = type_field{ .type = field_type, .default_value = default_value_expression, .index = i };
 		}
-		else if (current_token == ";") {} // ok whatever
+		else if (current_token.is(token_kind::semicolon)) {} // ok whatever
 		else {
-			throw std::runtime_error("expected member declaration or \"}\", got \"" + current_token + "\".");
+			throw std::runtime_error("expected member declaration or \"}\", got " + describe(current_token) + ".");
 		}
 
 		
@@ -1765,217 +1534,1223 @@ static void process_class_body(type_info_ class_type, type_info_ class_ref_type)
 static void process_code_body() {
 	std::cout << "processing code block\n";
 	int i = parser.taskStack.size();
-	std::string current_token;
+	token current_token;
 
 	while (parser.taskStack.size() >= i) {
 		assert(parser.taskStack[i - 1].task == parsing_task::code_body);
 		current_token = get_next_non_empty_token(true);
-		if (current_token == "") {
+		if (current_token.is(token_kind::end)) {
 			break; // program ended
 		}
+		int line = current_token.line;
+		size_t first_function = parser.pending_functions.size(); // function literals parsed from here on are part of this statement
+
 		// everything in a code body is either a return, a while loop, a for loop, an if statement, a class definition, a variable initialization + assignment, or an expression. (function definitions are expressions)
-		if (current_token == "class") {
-			std::string class_name = get_next_non_empty_token();
-			if (class_name.empty() || !parser.is_valid_symbol_name(class_name))
+		if (current_token.is(token_kind::keyword_class)) {
+			token class_name_token = get_next_non_empty_token();
+			std::string class_name(class_name_token.text);
+			if (!class_name_token.is(token_kind::identifier) || !parser.is_valid_symbol_name(class_name_token.symbol))
 				throw std::runtime_error("invalid class name");
 
-			if (get_next_non_empty_token() != "{")
+			if (!get_next_non_empty_token().is(token_kind::left_brace))
 				throw std::runtime_error("expected \"{\" after class name");
 
-			parser.scopeStack.back().known_symbols[class_name] = symbol_type::type;
 			parser.taskStack.push_back(parsing_task_info{ .task = parsing_task::class_body });
-			auto classtype = type_info_(new _type_info(false, class_name, {}, false));
-			auto classreftype = type_info_(new _type_info(true, class_name, {}, false));
-			parser.scopeStack.back().types[class_name] = classtype;
-			parser.scopeStack.back().types[class_name + "&"] = classreftype;
+			auto classtype = type_storage.make<_type_info>(false, class_name);
+			classtype->kind = type_kind::class_;
+			auto classreftype = make_reference_type(classtype);
+			parser.symbols.declare_type(classtype->id, classtype);
+			parser.symbols.declare_type(classreftype->id, classreftype);
 
 			process_class_body(classtype, classreftype);
-		}
-		else if (current_token == "return") {
-			if (parser.scopeStack.back().should_return) { // TODO: wrong, need to go back until you find one you can return from
-				if (parser.scopeStack.back().return_type != void_type) {
-					auto return_expression = get_next_expression().second;
-					auto expr_type = return_expression->get_type();
-
-
-					
-					// TODO: if return type is a reference type, return_expression must be an rvalue
-					auto [asmt, varname] = parser.scopeStack.back().return_type->pass_by_reference ? return_expression.second->retrieve_asm_value() : return_expression.second->retrieve_asm_value_copy();  
-					out += asmt;
-					out += "\ndvar " + return_asmvar += " sym:" + varname;
+			parser.add_statement(parser.nodes.make<class_declaration>(line, classtype), first_function);
+		}
+		else if (current_token.is(token_kind::keyword_return)) {
+			// might be inside some ifs/loops, so go back until we find the function
+			scope* function_scope = nullptr;
+			for (auto it = parser.scopeStack.rbegin(); it != parser.scopeStack.rend(); it++) {
+				if (it->should_return) {
+					function_scope = &*it;
+					break;
 				}
-				
-				out += "\njmp function_end_lbl";
 			}
-			else {
-				throw std::runtime_error("cannot return here");
+			if (!function_scope) throw std::runtime_error("cannot return here");
+
+			expression* return_expression = nullptr;
+			if (function_scope->return_type != void_type) {
+				return_expression = get_next_expression();
+				if (!return_expression) throw std::runtime_error("expected return value");
 			}
+			parser.add_statement(parser.nodes.make<return_statement>(line, function_scope->function, return_expression), first_function);
 		}
-		else if (current_token == "while") {
-			if (get_next_non_empty_token() != "(")
+		else if (current_token.is(token_kind::keyword_while)) {
+			if (!get_next_non_empty_token().is(token_kind::left_paren))
 				throw std::runtime_error("expected \"(\" before while loop header");
 
 			auto loop_condition = get_next_expression();
+			check_condition(loop_condition, "while loop");
 
-			if (get_next_non_empty_token() != ")")
+			if (!get_next_non_empty_token().is(token_kind::right_paren))
 				throw std::runtime_error("expected \")\" to close while loop header");
 
-			if (get_next_non_empty_token() != "{")  // TODO: one-expression loops/ifs without brackets?
+			if (!get_next_non_empty_token().is(token_kind::left_brace))  // TODO: one-expression loops/ifs without brackets?
 				throw std::runtime_error("expected \"{\" after while loop header");
 
-			parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1 });
-			parser.scopeStack.push_back(scope{ .known_symbols = {}, .type = scope_type::while_ });
+			auto loop = parser.nodes.make<while_statement>(line, loop_condition);
+			parser.add_statement(loop, first_function);
+			parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1, &loop->body });
+			parser.push_scope(scope{ .type = scope_type::while_ });
 		}
-		else if (current_token == "else") {
+		else if (current_token.is(token_kind::keyword_else)) {
 			throw std::runtime_error("invalid else");
 		}
-		else if (current_token == "elseif") {
+		else if (current_token.is(token_kind::keyword_elseif)) {
 			throw std::runtime_error("invalid elseif");
 		}
-		else if (current_token == "for") {
+		else if (current_token.is(token_kind::keyword_for)) {
 			std::cout << "Parsing for loop.\n";
 
-			if (get_next_non_empty_token() != "(")
+			if (!get_next_non_empty_token().is(token_kind::left_paren))
 				throw std::runtime_error("expected \"(\" before for loop header");
 
-			parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1 }); // make sure for loop's defined variable is part of this scope, not the outer scope
-			parser.scopeStack.push_back(scope{ .known_symbols = {}, .type = scope_type::for_ });
+			auto loop = parser.nodes.make<for_statement>(line);
+			block* outer_body = parser.taskStack.back().body;
+			parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1, &loop->body }); // make sure for loop's defined variable is part of this scope, not the outer scope
+			parser.push_scope(scope{ .type = scope_type::for_ });
 
 			auto loop_initial = get_expression_or_variable_assignment();
-			if (get_next_non_empty_token() != ",")
+			if (!get_next_non_empty_token().is(token_kind::comma))
 				throw std::runtime_error("expected \",\" between for loop header initial expression and conditional expression");
 			if (std::holds_alternative<variable_assignment>(loop_initial)) {
 				declare_variable(std::get<variable_assignment>(loop_initial));
-				// actually make the variable exist
-				std::string asmm = std::get<variable_assignment>(loop_initial).get_asm();
-				out += asmm;
+				loop->initial = std::get<variable_assignment>(loop_initial).make_declaration(line);
+			}
+			else if (std::get<expression*>(loop_initial)) {
+				loop->initial = parser.nodes.make<expression_statement>(line, std::get<expression*>(loop_initial));
 			}
 
 			auto loop_condition = get_next_expression();
-			if (get_next_non_empty_token() != ",")
+			if (!get_next_non_empty_token().is(token_kind::comma))
 				throw std::runtime_error("expected \",\" between for loop header conditional expression and iteration expression");
-			auto loop_increment = get_next_expression();
+			if (loop_condition) {
+				check_condition(loop_condition, "for loop");
+				loop->condition = loop_condition;
+			}
+
+			loop->increment = get_next_expression();
 
-			if (get_next_non_empty_token() != ")")
+			if (!get_next_non_empty_token().is(token_kind::right_paren))
 				throw std::runtime_error("expected \")\" to close for loop header");
 
-			if (get_next_non_empty_token() != "{")  // TODO: one-expression loops/ifs without brackets?
+			if (!get_next_non_empty_token().is(token_kind::left_brace))  // TODO: one-expression loops/ifs without brackets?
 				throw std::runtime_error("expected \"{\" after for loop header");
 
-
+			parser.add_statement(loop, first_function, outer_body);
 		}
-		else if (current_token == "if") {
+		else if (current_token.is(token_kind::keyword_if)) {
 
-			if (get_next_non_empty_token() != "(")
+			if (!get_next_non_empty_token().is(token_kind::left_paren))
 				throw std::runtime_error("expected \"(\" before if condition");
 
 			auto if_condition = get_next_expression();
-			// TODO: ASSERT CONVERTIBILITY TO BOOLEAN
-
+			check_condition(if_condition, "if");
 
-
-			if (get_next_non_empty_token() != ")")
+			if (!get_next_non_empty_token().is(token_kind::right_paren))
 				throw std::runtime_error("expected \")\" to close if condition");
 
 
-			if (get_next_non_empty_token() != "{")  // TODO: one-expression loops/ifs without brackets?
+			if (!get_next_non_empty_token().is(token_kind::left_brace))  // TODO: one-expression loops/ifs without brackets?
 				throw std::runtime_error("expected \"{\" after if statement");
 
-			parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1 });
-			parser.scopeStack.push_back(scope{ .known_symbols = {}, .type = scope_type::if_ });
+			auto if_chain = parser.nodes.make<if_statement>(line);
+			auto body = parser.nodes.make<block>();
+			if_chain->branches.push_back({ if_condition, body });
+			parser.add_statement(if_chain, first_function);
+			parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1, body, if_chain });
+			parser.push_scope(scope{ .type = scope_type::if_ });
 		}
-		else if (current_token == "}") { // exit code body
+		else if (current_token.is(token_kind::right_brace)) { // exit code body
 			bool could_have_else = parser.scopeStack.back().type == scope_type::if_;
-			auto stype = parser.scopeStack.back().type;
+			if_statement* if_chain = parser.taskStack.back().if_chain;
 			parser.taskStack.pop_back();
-			parser.scopeStack.pop_back();
+			parser.pop_scope();
 			if (parser.taskStack.empty()) throw std::runtime_error("expected <eof>, got \"}\"");
 
 			if (could_have_else) {
-				auto next = get_next_non_empty_token();
-				if (next == "else") {
-					//if (!could_have_else) throw std::runtime_error("invalid else");
+				assert(if_chain);
+				const token& next = tokenizer.peek(); // (might be eof, an if can be the last thing in the script)
+				if (next.is(token_kind::keyword_else)) {
+					tokenizer.next_token();
 
-					if (get_next_non_empty_token() != "{")  // TODO: one-expression loops/ifs without brackets?
+					if (!get_next_non_empty_token().is(token_kind::left_brace))  // TODO: one-expression loops/ifs without brackets?
 						throw std::runtime_error("expected \"{\" after else statement");
 
-					parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1 });
-					parser.scopeStack.push_back(scope{ .known_symbols = {}, .type = scope_type::else_ });
+					if_chain->else_body = parser.nodes.make<block>();
+					parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1, if_chain->else_body });
+					parser.push_scope(scope{ .type = scope_type::else_ });
 				}
-				else if (next == "elseif") {
-					//if (!could_have_else) throw std::runtime_error("invalid elseif");
+				else if (next.is(token_kind::keyword_elseif)) {
+					tokenizer.next_token();
+
+					if (!get_next_non_empty_token().is(token_kind::left_paren))
+						throw std::runtime_error("expected \"(\" before elseif condition");
 
 					auto if_condition = get_next_expression();
-					// TODO: ASSERT CONVERTIBILITY TO BOOLEAN
+					check_condition(if_condition, "elseif");
+					parser.take_pending_functions(if_chain, first_function); // so they're defined before the whole if
+
+					if (!get_next_non_empty_token().is(token_kind::right_paren))
+						throw std::runtime_error("expected \")\" to close elseif condition");
 
-					if (get_next_non_empty_token() != "{")  // TODO: one-expression loops/ifs without brackets?
+					if (!get_next_non_empty_token().is(token_kind::left_brace))  // TODO: one-expression loops/ifs without brackets?
 						throw std::runtime_error("expected \"{\" after if statement");
 
-					parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1 });
-					parser.scopeStack.push_back(scope{ .known_symbols = {}, .type = scope_type::if_ });
-				}
-				else {
-					return_token(next);
+					auto body = parser.nodes.make<block>();
+					if_chain->branches.push_back({ if_condition, body });
+					parser.taskStack.push_back(parsing_task_info{ parsing_task::code_body, -1, body, if_chain });
+					parser.push_scope(scope{ .type = scope_type::if_ });
 				}
 			}
-			else if (stype == scope_type::function) {
-				//out += "\nlabel function_end_lbl";
-			}
 		}
-		else if (current_token == ";") {}
+		else if (current_token.is(token_kind::semicolon)) {}
 		else {
-			return_token(current_token);
+			tokenizer.unget();
 
 			auto variant = get_expression_or_variable_assignment();
 
 			if (std::holds_alternative<variable_assignment>(variant)) {
-
 				declare_variable(std::get<variable_assignment>(variant));
-				// actually make the variable exist
-				auto asmm = std::get<variable_assignment>(variant).get_asm();
-				out += asmm;
-				
+				parser.add_statement(std::get<variable_assignment>(variant).make_declaration(line), first_function);
 			}
-			else {
-				out += std::get<0>(variant).second->retrieve_asm_value().first;
-				
+			else if (std::get<expression*>(variant)) {
+				parser.add_statement(parser.nodes.make<expression_statement>(line, std::get<expression*>(variant)), first_function);
 			}
 		}
 	}
 	std::cout << "exiting code block\n";
 }
 
-int main(const char** args, int nargs) {
-	
-	parser.taskStack.push_back(parsing_task_info { parsing_task::code_body, -1 });
-	parser.scopeStack.push_back(scope {
-		.known_symbols = {
-			{"i32", symbol_type::type},
-			{"f64", symbol_type::type},
-			{"string", symbol_type::type},
-			{"void", symbol_type::type},
-			{"bool", symbol_type::type},
-			{"var", symbol_type::type}
-		},
-		.type = scope_type::main
-	});
+// CODE GENERATION
+// runs once the whole script is parsed, appends to out
 
-	
+static void generate_block(const block& body);
+static void generate_statement(statement* s);
 
-	src = ";\n;\n;\n;" + get_src("test1.tla");
-	out = "";
+// whether inverse_jump gives the jump that jumps exactly when this one doesn't. (doubles' inverse jumps aren't, when comparing against NaN)
+static bool invertible(opcode jump) {
+	return jump < opcode::fje || jump == opcode::dje || jump == opcode::djne;
+}
 
-	// handle return statements
-	out += "\ndvar " + return_asmvar + " sint:0";
+// jumps to label if the condition is the given value, and otherwise carries on.
+// comparisons are jumped on directly instead of being put in a bool first, and so are the operands of !, && and ||.
+static void branch_if(operand& condition, bool value, symbol_id label) {
+	if (auto b = dynamic_cast<binary_operation*>(&condition)) {
+		auto& op = binary_operators[static_cast<size_t>(b->op)];
+		if (op.jump_if_false) {
+			auto o1 = evaluate_operand(b->lhs, b->lhs_value);
+			auto o2 = evaluate_operand(b->rhs, b->rhs_value);
+			auto c = compare(op.jump_if_false->first, op.jump_if_false->second, *o1, *o2);
+
+			if (c.result.has_value()) {
+				if (*c.result == value) out.emit(opcode::jmp, { mcasm_operand::label_name(label) });
+			}
+			else if (!value) {
+				out.emit(c.jump_if_false, { mcasm_operand::label_name(label), c.a, c.b });
+			}
+			else if (invertible(c.jump_if_false)) {
+				out.emit(inverse_jump(c.jump_if_false), { mcasm_operand::label_name(label), c.a, c.b });
+			}
+			else {
+				auto skip = get_next_label_name("_skip");
+				out.emit(c.jump_if_false, { mcasm_operand::label_name(skip), c.a, c.b });
+				out.emit(opcode::jmp, { mcasm_operand::label_name(label) });
+				out.emit(opcode::label, { mcasm_operand::label_name(skip) });
+			}
+			return;
+		}
+		if (b->op == operator_id::logical_and || b->op == operator_id::logical_or) {
+			// a && b is false if a is, a || b is true if a is. otherwise it's whatever b is.
+			bool decided_by_lhs = b->op == operator_id::logical_or;
+			if (value == decided_by_lhs) {
+				branch_if(*b->lhs, value, label);
+				branch_if(*b->rhs, value, label);
+			}
+			else {
+				auto skip = get_next_label_name("_skip");
+				branch_if(*b->lhs, decided_by_lhs, skip);
+				branch_if(*b->rhs, value, label);
+				out.emit(opcode::label, { mcasm_operand::label_name(skip) });
+			}
+			return;
+		}
+	}
+	else if (auto u = dynamic_cast<unary_operation*>(&condition); u && u->op == operator_id::logical_not) {
+		branch_if(*u->value, !value, label);
+		return;
+	}
+
+	auto v = condition.retrieve_asm_value();
+	if (v.kind == mcasm_operand::kind_t::sint) { // known at compile time
+		if ((v.int_value != 0) == value) out.emit(opcode::jmp, { mcasm_operand::label_name(label) });
+		return;
+	}
+	out.emit(value ? opcode::sjne : opcode::sje, { mcasm_operand::label_name(label), v, mcasm_operand::sint(0) });
+}
+
+// jumps to label if the condition is false
+static void branch_if_false(expression& condition, symbol_id label) {
+	branch_if(*condition.root, false, label);
+}
+
+// code that's been generated once but has to go in more than once (the body of an unrolled loop, a loop's condition), so its nodes still only get generated once.
+// starts recording when it's made. each copy after the first gets its own labels and temporaries (the names made while it was generated), like generating it again would have given it.
+class generated_code {
+public:
+	generated_code() : start(out.code.size()), first_new_name(interner.size()) {}
+
+	// takes what's been generated since it was made back out of out
+	void take() {
+		code.assign(out.code.begin() + start, out.code.end());
+		out.code.resize(start);
+	}
+
+	const std::vector<instruction>& instructions() const { return code; }
+
+	// puts a copy of it at the end of out, with jumps to the labels in retarget going to the other label instead. returns where it starts.
+	size_t emit(const std::unordered_map<symbol_id, symbol_id>& retarget = {}) {
+		size_t at = out.code.size();
+		std::unordered_map<symbol_id, symbol_id> names;
+		auto rename = [&](mcasm_operand& o) {
+			if (o.kind != mcasm_operand::kind_t::name && o.kind != mcasm_operand::kind_t::symbol && o.kind != mcasm_operand::kind_t::label) return;
+			if (auto r = retarget.find(o.name); r != retarget.end()) o.name = r->second;
+			else if (copies > 0 && o.name >= first_new_name) {
+				auto [n, added] = names.try_emplace(o.name, no_symbol);
+				if (added) n->second = fresh_name(o);
+				o.name = n->second;
+			}
+		};
+		for (auto copy : code) {
+			for (size_t k = 0; k < copy.operand_count; k++) {
+				auto& o = copy[k];
+				if (o.kind == mcasm_operand::kind_t::arguments || o.kind == mcasm_operand::kind_t::parameters) {
+					if (copies == 0) continue;
+					auto elements = out.lists[o.index]; // (the copy needs its own list, or renaming one would rename both)
+					for (auto& e : elements) rename(e);
+					o = o.kind == mcasm_operand::kind_t::arguments ? out.arguments(std::move(elements)) : out.parameters(std::move(elements));
+				}
+				else {
+					rename(o);
+				}
+			}
+			out.code.push_back(copy);
+		}
+		copies++;
+		return at;
+	}
+
+private:
+	size_t start;
+	symbol_id first_new_name; // names from here on were made for it. (the interner's IDs only go up)
+	std::vector<instruction> code;
+	int copies = 0;
+
+	// a new name like the old one (the same suffix after its number, so "v12_copy" gets "v40_copy")
+	static symbol_id fresh_name(const mcasm_operand& o) {
+		bool label = o.kind == mcasm_operand::kind_t::label;
+		auto name = interner.name(o.name);
+		auto suffix = name.substr(std::min(name.size(), name.find_first_not_of("0123456789", label ? 2 : 1)));
+		return label ? get_next_label_name(suffix) : get_next_assembly_name(suffix);
+	}
+};
+
+// loops are rotated: the condition is checked once on the way in, and then at the bottom of each iteration, which jumps back up to the top if it's still true.
+// so each iteration only runs the one jump, instead of a check at the top and a jmp at the bottom.
+// the condition is only generated once, for the check at the bottom, and the check on the way in is a copy of it that jumps in or past the loop.
+// no condition loops forever. the check on the way in can be left out if the loop is known to run at least once.
+static void generate_loop(expression* condition, const std::function<void()>& iteration, bool check_first = true) {
+	auto loop_label = get_next_label_name("_loop");
+	auto end_label = get_next_label_name("_loop_end");
+
+	generated_code check;
+	if (condition) branch_if(*condition->root, true, loop_label);
+	check.take();
+
+	if (condition && check_first) {
+		// if it ends in the only jump into the loop, that jump can just be turned around to skip the loop instead
+		auto& c = check.instructions();
+		auto jumps_in = [&](const instruction& in) { return (in.op == opcode::jmp || is_conditional_jump(in.op)) && in[0].name == loop_label; };
+		if (!c.empty() && is_conditional_jump(c.back().op) && invertible(c.back().op) && std::count_if(c.begin(), c.end(), jumps_in) == 1 && jumps_in(c.back())) {
+			check.emit({ { loop_label, end_label } });
+			out.code.back().op = inverse_jump(out.code.back().op);
+		}
+		else {
+			auto enter_label = get_next_label_name("_loop_enter");
+			check.emit({ { loop_label, enter_label } });
+			out.emit(opcode::jmp, { mcasm_operand::label_name(end_label) });
+			out.emit(opcode::label, { mcasm_operand::label_name(enter_label) });
+		}
+	}
+	out.emit(opcode::label, { mcasm_operand::label_name(loop_label) });
+	iteration();
+	if (condition) check.emit();
+	else out.emit(opcode::jmp, { mcasm_operand::label_name(loop_label) });
+	out.emit(opcode::label, { mcasm_operand::label_name(end_label) });
+}
+
+static void generate_function_definition(function_literal& func) {
+	func.end_label = get_next_label_name("_function_end");
+
+	std::vector<mcasm_operand> parameters;
+	for (auto asm_argname : func.parameter_asm_names) parameters.push_back(mcasm_operand::variable(asm_argname));
+	out.emit(opcode::dfunc, { mcasm_operand::variable(func.asm_name), out.parameters(std::move(parameters)) });
+
+	generate_block(func.body);
+
+	out.emit(opcode::label, { mcasm_operand::label_name(func.end_label) });
+	out.emit(opcode::endfunc, {});
+}
+
+// for loops that count with a constant (like "for (i32 i = 0, i < 8, i += 1)") run a number of times that's known at compile time, so they're unrolled.
+// completely if all the copies of the body come to at most unroll_size_limit statements, and otherwise unroll_factor copies of it go between each check (1 turns that off).
+constexpr int unroll_size_limit = 32;
+constexpr int unroll_factor = 4;
+
+// whether o could change the variable, or make another name for it that something else could change it through.
+// errs on the side of yes: anywhere it's passed as a whole (to a function, into an object...) counts.
+static bool may_modify(operand* o, symbol_id variable) {
+	auto is_variable = [variable](operand* o) {
+		if (auto e = dynamic_cast<expression*>(o)) o = e->root;
+		auto v = dynamic_cast<varname*>(o);
+		return v && v->asmvarname == variable;
+	};
+
+	if (auto e = dynamic_cast<expression*>(o)) return may_modify(e->root, variable);
+	if (auto b = dynamic_cast<binary_operation*>(o)) {
+		bool assigns = b->op >= operator_id::assign && b->op <= operator_id::modulo_assign;
+		if (assigns && is_variable(b->lhs)) return true;
+		if (b->op == operator_id::assign && is_variable(b->rhs) && b->lhs->get_type()->pass_by_reference) return true; // (r = i, for an i32& r)
+		return may_modify(b->lhs, variable) || may_modify(b->rhs, variable);
+	}
+	if (auto u = dynamic_cast<unary_operation*>(o)) return may_modify(u->value, variable);
+	if (auto call = dynamic_cast<funccall*>(o)) {
+		for (auto arg : call->args) {
+			if (is_variable(arg) || may_modify(arg, variable)) return true;
+		}
+		return may_modify(call->function, variable);
+	}
+	if (auto creation = dynamic_cast<object_creation*>(o)) {
+		for (auto& f : creation->fields) {
+			if (is_variable(f.field_value) || may_modify(f.field_value, variable)) return true;
+		}
+	}
+	return false;
+}
+
+static bool may_modify(const block& body, symbol_id variable);
+
+static bool may_modify(statement* s, symbol_id variable) {
+	auto may_modify_or_is = [variable](expression* e) {
+		auto v = dynamic_cast<varname*>(e->root);
+		return (v && v->asmvarname == variable) || may_modify(e, variable);
+	};
+
+	switch (s->kind) {
+	case statement_kind::expression:
+		return may_modify(static_cast<expression_statement*>(s)->value, variable);
+	case statement_kind::variable_declaration:
+		return may_modify_or_is(static_cast<variable_declaration*>(s)->value); // (i32& r = i)
+	case statement_kind::return_: {
+		auto ret = static_cast<return_statement*>(s);
+		return ret->value && may_modify_or_is(ret->value);
+	}
+	case statement_kind::while_: {
+		auto loop = static_cast<while_statement*>(s);
+		return may_modify(loop->condition, variable) || may_modify(loop->body, variable);
+	}
+	case statement_kind::for_: {
+		auto loop = static_cast<for_statement*>(s);
+		return (loop->initial && may_modify(loop->initial, variable)) || (loop->condition && may_modify(loop->condition, variable))
+			|| (loop->increment && may_modify(loop->increment, variable)) || may_modify(loop->body, variable);
+	}
+	case statement_kind::if_: {
+		auto if_chain = static_cast<if_statement*>(s);
+		for (auto& branch : if_chain->branches) {
+			if (may_modify(branch.condition, variable) || may_modify(*branch.body, variable)) return true;
+		}
+		return if_chain->else_body && may_modify(*if_chain->else_body, variable);
+	}
+	case statement_kind::class_declaration:
+		return false;
+	}
+	return true;
+}
+
+static bool may_modify(const block& body, symbol_id variable) {
+	for (auto s : body.statements) {
+		if (may_modify(s, variable)) return true;
+	}
+	return false;
+}
+
+// how many statements generating the block generates, counting the ones in nested blocks. -1 if it defines any functions, since copying the block would define them again.
+static int statement_count(const block& body) {
+	int count = 0;
+	for (auto s : body.statements) {
+		if (!s->functions.empty()) return -1;
+		count++;
+
+		std::vector<const block*> nested;
+		if (s->kind == statement_kind::while_) nested.push_back(&static_cast<while_statement*>(s)->body);
+		else if (s->kind == statement_kind::for_) nested.push_back(&static_cast<for_statement*>(s)->body);
+		else if (s->kind == statement_kind::if_) {
+			auto if_chain = static_cast<if_statement*>(s);
+			for (auto& branch : if_chain->branches) nested.push_back(branch.body);
+			if (if_chain->else_body) nested.push_back(if_chain->else_body);
+		}
+		for (auto b : nested) {
+			int n = statement_count(*b);
+			if (n < 0) return -1;
+			count += n;
+		}
+	}
+	return count;
+}
+
+static std::optional<int32_t> int_literal(operand* o) {
+	if (auto e = dynamic_cast<expression*>(o)) o = e->root;
+	auto l = dynamic_cast<literal*>(o);
+	if (!l || l->type != i32_type) return std::nullopt;
+	return l->int_value;
+}
+
+// a for loop's variable starts at start and goes up by step (down if it's negative), and the body runs count times
+struct trip_count {
+	int32_t start, step;
+	int64_t count;
+};
+
+// the trip count, if the loop is "for (i32 i = a, i (compared to) b, i (+= or -=) c)" and nothing else changes i.
+// worked out from a, b and c rather than by counting, so a long loop doesn't cost anything. nullopt if it isn't one, or if it'd never stop or wrap around.
+static std::optional<trip_count> constant_iterations(for_statement& loop) {
+	if (!loop.initial || !loop.condition || !loop.increment || loop.initial->kind != statement_kind::variable_declaration) return std::nullopt;
+	auto declaration = static_cast<variable_declaration*>(loop.initial);
+	auto start = int_literal(declaration->value);
+	if (declaration->type != i32_type || !start) return std::nullopt;
+	auto variable = declaration->asm_name;
+
+	auto is_variable = [variable](operand* o) {
+		auto v = dynamic_cast<varname*>(o);
+		return v && v->asmvarname == variable;
+	};
+
+	auto condition = dynamic_cast<binary_operation*>(loop.condition->root);
+	if (!condition || !is_variable(condition->lhs)) return std::nullopt;
+	auto bound = int_literal(condition->rhs);
+	if (!bound) return std::nullopt;
+
+	auto increment = dynamic_cast<binary_operation*>(loop.increment->root);
+	if (!increment || !is_variable(increment->lhs)) return std::nullopt;
+	auto step = int_literal(increment->rhs);
+	if (!step || (increment->op != operator_id::add_assign && increment->op != operator_id::subtract_assign)) return std::nullopt;
+
+	if (may_modify(loop.condition, variable) || may_modify(loop.body, variable)) return std::nullopt;
+
+	// (in 64 bits, where none of this can overflow)
+	int64_t s = *start, b = *bound, d = increment->op == operator_id::subtract_assign ? -int64_t(*step) : *step;
+	if (d < INT32_MIN || d > INT32_MAX) return std::nullopt; // (-= INT32_MIN)
+	int64_t count;
+	switch (condition->op) {
+	case operator_id::less:
+		if (s >= b) count = 0;
+		else if (d <= 0) return std::nullopt;
+		else count = (b - s + d - 1) / d;
+		break;
+	case operator_id::less_equal:
+		if (s > b) count = 0;
+		else if (d <= 0) return std::nullopt;
+		else count = (b - s) / d + 1;
+		break;
+	case operator_id::greater:
+		if (s <= b) count = 0;
+		else if (d >= 0) return std::nullopt;
+		else count = (s - b - d - 1) / -d;
+		break;
+	case operator_id::greater_equal:
+		if (s < b) count = 0;
+		else if (d >= 0) return std::nullopt;
+		else count = (s - b) / -d + 1;
+		break;
+	case operator_id::equal:
+		if (s != b) count = 0;
+		else if (d == 0) return std::nullopt;
+		else count = 1;
+		break;
+	case operator_id::not_equal:
+		if (s == b) count = 0;
+		else if (d == 0 || (b - s) % d != 0 || (b - s) / d < 0) return std::nullopt; // (it'd step over b)
+		else count = (b - s) / d;
+		break;
+	default:
+		return std::nullopt;
+	}
+
+	// the value that stops the loop has to fit too, or i would wrap around before getting there (all the others are between it and the start)
+	int64_t last = s + count * d;
+	if (last < INT32_MIN || last > INT32_MAX) return std::nullopt;
+	return trip_count{ .start = *start, .step = static_cast<int32_t>(d), .count = count };
+}
+
+// generates the loop unrolled, if it's a for loop with a trip count known at compile time (see unroll_size_limit). returns false if it isn't, without generating anything.
+static bool generate_unrolled_loop(for_statement& loop) {
+	int size = statement_count(loop.body);
+	if (size < 0) return false;
+	auto iterations = constant_iterations(loop);
+	if (!iterations) return false;
+
+	// (the body is generated once, and the copies are copies of the code it generated)
+	auto declaration = static_cast<variable_declaration*>(loop.initial);
+	if (iterations->count * std::max(size, 1) <= unroll_size_limit) {
+		if (iterations->count == 0) return true;
+
+		// each copy gets the variable's value as a constant, so no increments or checks are left at all
+		generated_code body;
+		out.emit(opcode::dvar, { mcasm_operand::variable(declaration->asm_name), mcasm_operand::sint(0) }, interner.intern(declaration->var_name));
+		generate_block(loop.body);
+		body.take();
+		for (int64_t k = 0; k < iterations->count; k++) {
+			auto value = static_cast<int32_t>(iterations->start + k * iterations->step);
+			out.code[body.emit()][1] = mcasm_operand::sint(value);
+		}
+		return true;
+	}
+	if (unroll_factor < 2 || unroll_factor * size > unroll_size_limit) return false;
+
+	// the leftover iterations go first, so the condition is only ever checked after a whole batch of them and is false exactly when they've all run.
+	// (there's always at least one batch, since otherwise it would've been unrolled completely)
+	generate_statement(loop.initial);
+	generated_code iteration;
+	generate_block(loop.body);
+	loop.increment->retrieve_asm_value();
+	iteration.take();
+
+	for (int64_t i = 0; i < iterations->count % unroll_factor; i++) iteration.emit();
+	generate_loop(loop.condition, [&]() {
+		for (int i = 0; i < unroll_factor; i++) iteration.emit();
+	}, false);
+	return true;
+}
+
+static void generate_statement(statement* s) {
+	for (auto& func : s->functions) generate_function_definition(*func);
+
+	switch (s->kind) {
+	case statement_kind::expression: {
+		static_cast<expression_statement*>(s)->value->retrieve_asm_value();
+		break;
+	}
+	case statement_kind::variable_declaration: {
+		auto declaration = static_cast<variable_declaration*>(s);
+		auto& value = declaration->value;
+		mcasm_operand asmvar;
+
+		if (value->get_type() != declaration->type && value->get_reference_type() != declaration->type) {
+			auto converted = implicit_convert_to_type(value->retrieve_asm_value_copy(), value->get_type(), declaration->type);
+			if (!converted.has_value()) throw std::runtime_error("cannot assign expression of type " + value->get_type()->name + " to variable of type " + declaration->type->name);
+			asmvar = *converted;
+		}
+		else {
+			asmvar = value->retrieve_asm_value();
+		}
+
+		out.emit(opcode::dvar, { mcasm_operand::variable(declaration->asm_name), asmvar }, interner.intern(declaration->var_name));
+		break;
+	}
+	case statement_kind::return_: {
+		auto ret = static_cast<return_statement*>(s);
+		if (ret->value) {
+			type_info_ return_type = ret->function->return_type;
+
+			// TODO: if return type is a reference type, return_expression must be an rvalue
+			auto value = return_type->pass_by_reference ? ret->value->retrieve_asm_value() : ret->value->retrieve_asm_value_copy();
+			if (!return_type->pass_by_reference && ret->value->get_type() != return_type) {
+				auto converted = implicit_convert_to_type(value, ret->value->get_type(), return_type);
+				if (!converted.has_value()) throw std::runtime_error("cannot return expression of type " + ret->value->get_type()->name + " from function returning " + return_type->name);
+				value = *converted;
+			}
+			out.emit(opcode::dvar, { mcasm_operand::variable(return_asmvar), value });
+		}
+
+		out.emit(opcode::jmp, { mcasm_operand::label_name(ret->function->end_label) });
+		break;
+	}
+	case statement_kind::while_: {
+		auto loop = static_cast<while_statement*>(s);
+		generate_loop(loop->condition, [&]() { generate_block(loop->body); });
+		break;
+	}
+	case statement_kind::for_: {
+		auto loop = static_cast<for_statement*>(s);
+		if (generate_unrolled_loop(*loop)) break;
+
+		if (loop->initial) generate_statement(loop->initial);
+		generate_loop(loop->condition, [&]() {
+			generate_block(loop->body);
+			if (loop->increment) loop->increment->retrieve_asm_value();
+		});
+		break;
+	}
+	case statement_kind::if_: {
+		auto if_chain = static_cast<if_statement*>(s);
+		auto end_label = get_next_label_name("_if_end");
+
+		for (auto& branch : if_chain->branches) {
+			auto next_label = get_next_label_name("_else");
+			branch_if_false(*branch.condition, next_label);
+			generate_block(*branch.body);
+			out.emit(opcode::jmp, { mcasm_operand::label_name(end_label) });
+			out.emit(opcode::label, { mcasm_operand::label_name(next_label) });
+		}
+		if (if_chain->else_body) generate_block(*if_chain->else_body);
+		out.emit(opcode::label, { mcasm_operand::label_name(end_label) });
+		break;
+	}
+	case statement_kind::class_declaration:
+		break; // nothing to do besides its methods, which are already defined
+	}
+}
+
+static void generate_block(const block& body) {
+	for (auto s : body.statements) generate_statement(s);
+}
+
+// C GENERATION
+// the other backend: the same tree as portable C (C99), which the system C compiler can turn into a native executable.
+// i32, f64 and bool are int32_t, double and bool, strings are const char*, class objects are structs, function values are function pointers and references are pointers.
+// functions are all defined at the top level, and the main script's variables are main()'s locals, unless a function uses them (then they're file scope).
+// runs after the MCASM is generated, so the program is already known to be valid.
+
+// what every generated program starts with
+const char* const c_prelude = R"(#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void tla_fail(const char* message) {
+	fprintf(stderr, "runtime error: %s\n", message);
+	exit(EXIT_FAILURE);
+}
+
+// i32 arithmetic wraps around, like it does in MCVM
+static inline int32_t tla_add(int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+static inline int32_t tla_sub(int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+static inline int32_t tla_mul(int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+static inline int32_t tla_div(int32_t a, int32_t b) {
+	if (b == 0) tla_fail("division by 0");
+	return b == -1 ? tla_sub(0, a) : a / b;
+}
+static inline int32_t tla_mod(int32_t a, int32_t b) {
+	if (b == 0) tla_fail("division by 0");
+	return b == -1 ? 0 : a % b;
+}
+)";
+
+struct c_program {
+	std::string class_declarations; // typedef struct ... so classes can point at each other
+	std::string types; // function pointer typedefs and struct definitions, each after the types it uses
+	std::string globals;
+	std::string prototypes;
+	std::string functions;
+
+	std::unordered_map<type_info_, std::string> type_names; // of classes and function types
+	std::unordered_set<std::string> used_type_names;
+
+	std::unordered_map<symbol_id, function_literal*> owners; // the function each variable is declared in (nullptr for the main script)
+	std::unordered_set<symbol_id> shared_globals; // main script variables that functions use
+	std::vector<function_literal*> all_functions;
+	std::vector<type_info_> classes; // in the order they're declared
+
+	function_literal* current_function = nullptr; // nullptr while generating main()
+	std::string* body = nullptr; // where statements go
+	int depth = 0;
+
+	void line(const std::string& text) {
+		body->append(depth, '\t');
+		*body += text;
+		*body += '\n';
+	}
+};
+
+c_program c_out;
+
+static std::string c_type(type_info_ t);
+
+// makes up a name for a class or function type that no other one has
+static std::string c_type_name(type_info_ t, const std::string& base) {
+	auto name = base;
+	for (int n = 2; c_out.used_type_names.contains(name); n++) name = base + "_" + std::to_string(n);
+	c_out.used_type_names.insert(name);
+	return c_out.type_names[t] = name;
+}
+
+static std::string c_function_type(type_info_ t) {
+	auto found = c_out.type_names.find(t);
+	if (found != c_out.type_names.end()) return found->second;
+
+	std::string parameters;
+	for (auto argument_type : t->argument_types) parameters += (parameters.empty() ? "" : ", ") + c_type(argument_type);
+	auto return_type = c_type(t->return_type);
+	auto name = c_type_name(t, "function_" + std::to_string(c_out.type_names.size()));
+	c_out.types += "typedef " + return_type + " (*" + name + ")(" + (parameters.empty() ? "void" : parameters) + ");\n";
+	return name;
+}
+
+static std::string c_type(type_info_ t) {
+	if (t->pass_by_reference) return c_type(t->counterpart) + "*";
+	if (t == void_type) return "void";
+	if (t == i32_type) return "int32_t";
+	if (t == f64_type) return "double";
+	if (t == bool_type) return "bool";
+	if (t == string_type) return "const char*";
+	if (t->kind == type_kind::function) return c_function_type(t);
+	if (t->kind == type_kind::class_) return c_out.type_names.at(t);
+	throw std::runtime_error("type " + t->name + " has no C equivalent");
+}
+
+static std::string c_field_name(const std::string& field) {
+	return "f_" + field; // (so fields can be called things like "int")
+}
+
+static void define_c_struct(type_info_ class_type) {
+	std::vector<std::pair<std::string, type_info_>> fields(class_type->fields.size());
+	for (auto& [name, field] : class_type->fields) fields[field.index] = { name, field.type };
+
+	std::string definition = "struct " + c_type(class_type) + " {\n";
+	for (auto& [name, type] : fields) definition += "\t" + c_type(type) + " " + c_field_name(name) + ";\n";
+	if (fields.empty()) definition += "\tchar unused; // (C structs can't be empty)\n";
+	c_out.types += definition + "};\n";
+}
+
+static void find_c_declarations(const block& body, function_literal* owner);
+
+// finds what's declared where: every function, class and variable the statement declares, including in functions inside it
+static void find_c_declarations(statement* s, function_literal* owner) {
+	for (auto func : s->functions) {
+		c_out.all_functions.push_back(func);
+		for (auto parameter : func->parameter_asm_names) c_out.owners[parameter] = func;
+		find_c_declarations(func->body, func);
+	}
+
+	switch (s->kind) {
+	case statement_kind::variable_declaration:
+		c_out.owners[static_cast<variable_declaration*>(s)->asm_name] = owner;
+		break;
+	case statement_kind::while_:
+		find_c_declarations(static_cast<while_statement*>(s)->body, owner);
+		break;
+	case statement_kind::for_: {
+		auto loop = static_cast<for_statement*>(s);
+		if (loop->initial) find_c_declarations(loop->initial, owner);
+		find_c_declarations(loop->body, owner);
+		break;
+	}
+	case statement_kind::if_: {
+		auto if_chain = static_cast<if_statement*>(s);
+		for (auto& branch : if_chain->branches) find_c_declarations(*branch.body, owner);
+		if (if_chain->else_body) find_c_declarations(*if_chain->else_body, owner);
+		break;
+	}
+	case statement_kind::class_declaration:
+		c_out.classes.push_back(static_cast<class_declaration*>(s)->type);
+		break;
+	default:
+		break;
+	}
+}
+
+static void find_c_declarations(const block& body, function_literal* owner) {
+	for (auto s : body.statements) find_c_declarations(s, owner);
+}
+
+// the name of a variable, for the function being generated
+static std::string c_variable(varname& v) {
+	auto owner = c_out.owners.find(v.asmvarname);
+	assert(owner != c_out.owners.end());
+	if (owner->second != c_out.current_function) {
+		if (owner->second != nullptr) throw std::runtime_error("\"" + v.symname + "\" belongs to the function around the one using it, which C can't do");
+		if (c_out.shared_globals.insert(v.asmvarname).second) c_out.globals += "static " + c_type(v.type) + " " + std::string(interner.name(v.asmvarname)) + ";\n";
+	}
+	return std::string(interner.name(v.asmvarname));
+}
+
+static std::string c_literal(literal& l) {
+	if (l.type == null_type) return "NULL";
+	if (l.type == bool_type) return l.int_value ? "true" : "false";
+	if (l.type == i32_type) {
+		if (l.int_value == INT32_MIN) return "(-2147483647 - 1)"; // (2147483648 on its own is too big for an int)
+		return l.int_value < 0 ? "(" + std::to_string(l.int_value) + ")" : std::to_string(l.int_value);
+	}
+	if (l.type == f64_type) {
+		if (std::isnan(l.float_value)) return "NAN";
+		if (std::isinf(l.float_value)) return l.float_value < 0 ? "(-HUGE_VAL)" : "HUGE_VAL";
+		char digits[32];
+		std::string text(digits, std::to_chars(digits, digits + sizeof(digits), l.float_value).ptr); // (shortest text that reads back as the same double)
+		if (text.find_first_of(".e") == std::string::npos) text += ".0";
+		return l.float_value < 0 ? "(" + text + ")" : text;
+	}
+
+	assert(l.type == string_type);
+	std::string text = "\"";
+	for (unsigned char c : l.string_value()) {
+		if (c == '"' || c == '\\' || c == '?') text += '\\', text += c; // (? so it can't make a trigraph)
+		else if (c >= ' ' && c <= '~') text += c;
+		else {
+			char escape[5];
+			std::snprintf(escape, sizeof(escape), "\\%03o", c);
+			text += escape;
+		}
+	}
+	return text + "\"";
+}
+
+static std::string c_expression(operand* o);
+
+static bool is_c_pointer(operand* o) {
+	auto t = o->get_type();
+	return t && t->pass_by_reference;
+}
+
+// the operand's value, even if it's a reference
+static std::string c_value(operand* o) {
+	return is_c_pointer(o) ? "(*" + c_expression(o) + ")" : c_expression(o);
+}
+
+// a pointer to the operand's value. values that aren't in a variable are put in a compound literal, which lasts until the end of the block
+static std::string c_reference(operand* o) {
+	if (auto e = dynamic_cast<expression*>(o)) return c_reference(e->root);
+	if (is_c_pointer(o)) return c_expression(o);
+	if (auto l = dynamic_cast<literal*>(o); l && l->type == null_type) return "NULL";
+	if (auto v = dynamic_cast<varname*>(o)) return "&" + c_variable(*v);
+	return "&(" + c_type(o->get_type()) + "){" + c_expression(o) + "}";
+}
+
+// i32 arithmetic wraps around (see c_prelude), f64 arithmetic is just C's
+static std::string c_arithmetic(operator_id op, type_info_ type, const std::string& a, const std::string& b) {
+	bool i32 = type == i32_type;
+	switch (op) {
+	case operator_id::add: case operator_id::add_assign: return i32 ? "tla_add(" + a + ", " + b + ")" : "(" + a + " + " + b + ")";
+	case operator_id::subtract: case operator_id::subtract_assign: return i32 ? "tla_sub(" + a + ", " + b + ")" : "(" + a + " - " + b + ")";
+	case operator_id::multiply: case operator_id::multiply_assign: return i32 ? "tla_mul(" + a + ", " + b + ")" : "(" + a + " * " + b + ")";
+	case operator_id::divide: case operator_id::divide_assign: return i32 ? "tla_div(" + a + ", " + b + ")" : "(" + a + " / " + b + ")";
+	case operator_id::modulo: case operator_id::modulo_assign: return i32 ? "tla_mod(" + a + ", " + b + ")" : "fmod(" + a + ", " + b + ")";
+	default: assert(false); return {};
+	}
+}
+
+// an assignment, without the value it evaluates to (which is all a statement needs)
+static std::string c_assignment(binary_operation& b) {
+	auto target = dynamic_cast<varname*>(b.lhs);
+	assert(target);
+	auto name = c_variable(*target);
+	if (b.op == operator_id::assign) {
+		if (target->type->pass_by_reference) return name + " = " + c_reference(b.rhs); // (makes it refer to something else)
+		return name + " = " + c_value(b.rhs);
+	}
+	return (target->type->pass_by_reference ? "*" + name : name) + " = " + c_arithmetic(b.op, b.type, c_value(b.lhs), c_value(b.rhs));
+}
+
+static std::string c_binary_operation(binary_operation& b) {
+	const char* c_operators[] = { "==", "!=", "<", "<=", ">", ">=" };
+	int comparison = -1;
+	switch (b.op) {
+	case operator_id::multiply: case operator_id::divide: case operator_id::modulo: case operator_id::add: case operator_id::subtract:
+		return c_arithmetic(b.op, b.type, c_value(b.lhs), c_value(b.rhs));
+
+	case operator_id::equal: comparison = 0; break;
+	case operator_id::not_equal: comparison = 1; break;
+	case operator_id::less: comparison = 2; break;
+	case operator_id::less_equal: comparison = 3; break;
+	case operator_id::greater: comparison = 4; break;
+	case operator_id::greater_equal: comparison = 5; break;
+
+	case operator_id::reference_equal: return "(" + c_reference(b.lhs) + " == " + c_reference(b.rhs) + ")";
+	case operator_id::reference_not_equal: return "(" + c_reference(b.lhs) + " != " + c_reference(b.rhs) + ")";
+	case operator_id::logical_and: return "(" + c_value(b.lhs) + " && " + c_value(b.rhs) + ")";
+	case operator_id::logical_or: return "(" + c_value(b.lhs) + " || " + c_value(b.rhs) + ")";
+
+	case operator_id::assign: {
+		// evaluates to a reference to the variable if it was given a value, or its value if it was made to refer to something else
+		auto name = c_variable(*dynamic_cast<varname*>(b.lhs));
+		if (!b.type) return "(" + c_assignment(b) + ")"; // (function values have no reference type)
+		return "(" + c_assignment(b) + (b.type->pass_by_reference ? ", &" : ", *") + name + ")";
+	}
+	case operator_id::add_assign: case operator_id::subtract_assign: case operator_id::multiply_assign: case operator_id::divide_assign: case operator_id::modulo_assign:
+		if (!dynamic_cast<varname*>(b.lhs)) return c_arithmetic(b.op, b.type, c_value(b.lhs), c_value(b.rhs)); // (there's nothing to assign to)
+		return "(" + c_assignment(b) + ")";
+	default:
+		throw std::runtime_error("operator is unimplemented");
+	}
+
+	auto t1 = b.lhs->get_referenceless_type(), t2 = b.rhs->get_referenceless_type();
+	if (t1 == string_type && t2 == string_type) return "(strcmp(" + c_value(b.lhs) + ", " + c_value(b.rhs) + ") " + c_operators[comparison] + " 0)";
+	if (t1->kind == type_kind::class_ || t2->kind == type_kind::class_) throw std::runtime_error("the C backend can't compare class objects");
+	return "(" + c_value(b.lhs) + " " + c_operators[comparison] + " " + c_value(b.rhs) + ")";
+}
+
+static std::string c_object_creation(object_creation& creation) {
+	std::vector<std::string> values(creation.object_type->fields.size());
+	for (auto& [name, field] : creation.object_type->fields) {
+		operand* value = field.default_value;
+		for (auto& f : creation.fields) {
+			if (f.field_name == name) value = f.field_value;
+		}
+		values[field.index] = "." + c_field_name(name) + " = " + (field.type->pass_by_reference ? c_reference(value) : c_value(value));
+	}
+
+	std::string text = "((" + c_type(creation.object_type) + "){ ";
+	for (size_t i = 0; i < values.size(); i++) text += (i == 0 ? "" : ", ") + values[i];
+	return text + (values.empty() ? "0 })" : " })");
+}
+
+// the operand in its own type, so it's a pointer if that's a reference type
+static std::string c_expression(operand* o) {
+	if (auto e = dynamic_cast<expression*>(o)) return c_expression(e->root);
+	if (auto l = dynamic_cast<literal*>(o)) return c_literal(*l);
+	if (auto v = dynamic_cast<varname*>(o)) return c_variable(*v);
+	if (auto f = dynamic_cast<function_literal*>(o)) return std::string(interner.name(f->asm_name));
+	if (auto b = dynamic_cast<binary_operation*>(o)) return c_binary_operation(*b);
+	if (auto u = dynamic_cast<unary_operation*>(o)) {
+		assert(u->op == operator_id::logical_not);
+		return "(!" + c_value(u->value) + ")";
+	}
+	if (auto creation = dynamic_cast<object_creation*>(o)) return c_object_creation(*creation);
+	if (auto call = dynamic_cast<funccall*>(o)) {
+		auto& argument_types = call->function->get_type()->argument_types;
+		std::string text = c_value(call->function) + "(";
+		for (size_t i = 0; i < call->args.size(); i++) {
+			if (i != 0) text += ", ";
+			text += argument_types[i]->pass_by_reference ? c_reference(call->args[i]) : c_value(call->args[i]);
+		}
+		return text + ")";
+	}
+	assert(false);
+	return {};
+}
+
+static void generate_c_block(const block& body);
+
+static void generate_c_statement(statement* s) {
+	switch (s->kind) {
+	case statement_kind::expression: {
+		auto root = static_cast<expression_statement*>(s)->value->root;
+		auto b = dynamic_cast<binary_operation*>(root);
+		bool assignment = b && b->op >= operator_id::assign && b->op <= operator_id::modulo_assign && dynamic_cast<varname*>(b->lhs);
+		c_out.line((assignment ? c_assignment(*b) : c_expression(root)) + ";");
+		break;
+	}
+	case statement_kind::variable_declaration: {
+		auto declaration = static_cast<variable_declaration*>(s);
+		auto name = std::string(interner.name(declaration->asm_name));
+		auto value = declaration->type->pass_by_reference ? c_reference(declaration->value) : c_value(declaration->value);
+		if (!c_out.current_function && c_out.shared_globals.contains(declaration->asm_name)) c_out.line(name + " = " + value + ";"); // (already declared)
+		else c_out.line(c_type(declaration->type) + " " + name + " = " + value + ";");
+		break;
+	}
+	case statement_kind::return_: {
+		auto ret = static_cast<return_statement*>(s);
+		if (!ret->value) c_out.line("return;");
+		else c_out.line("return " + (ret->function->return_type->pass_by_reference ? c_reference(ret->value) : c_value(ret->value)) + ";");
+		break;
+	}
+	case statement_kind::while_: {
+		auto loop = static_cast<while_statement*>(s);
+		c_out.line("while (" + c_value(loop->condition) + ") {");
+		generate_c_block(loop->body);
+		c_out.line("}");
+		break;
+	}
+	case statement_kind::for_: {
+		// in its own block, so its variable goes out of scope after it like it does in Toola
+		auto loop = static_cast<for_statement*>(s);
+		c_out.line("{");
+		c_out.depth++;
+		if (loop->initial) generate_c_statement(loop->initial);
+		std::string condition = loop->condition ? c_value(loop->condition) : "";
+		std::string increment;
+		if (loop->increment) {
+			auto b = dynamic_cast<binary_operation*>(loop->increment->root);
+			increment = b && b->op >= operator_id::assign && b->op <= operator_id::modulo_assign && dynamic_cast<varname*>(b->lhs) ? c_assignment(*b) : c_expression(loop->increment);
+		}
+		c_out.line("for (; " + condition + "; " + increment + ") {");
+		generate_c_block(loop->body);
+		c_out.line("}");
+		c_out.depth--;
+		c_out.line("}");
+		break;
+	}
+	case statement_kind::if_: {
+		auto if_chain = static_cast<if_statement*>(s);
+		for (size_t i = 0; i < if_chain->branches.size(); i++) {
+			auto& branch = if_chain->branches[i];
+			c_out.line((i == 0 ? "if (" : "} else if (") + c_value(branch.condition) + ") {");
+			generate_c_block(*branch.body);
+		}
+		if (if_chain->else_body) {
+			c_out.line("} else {");
+			generate_c_block(*if_chain->else_body);
+		}
+		c_out.line("}");
+		break;
+	}
+	case statement_kind::class_declaration:
+		break; // (its struct is defined up front)
+	}
+}
+
+static void generate_c_block(const block& body) {
+	c_out.depth++;
+	for (auto s : body.statements) generate_c_statement(s);
+	c_out.depth--;
+}
+
+static void generate_c_function(function_literal& func) {
+	auto name = std::string(interner.name(func.asm_name));
+	std::string parameters;
+	for (size_t i = 0; i < func.parameter_asm_names.size(); i++) {
+		parameters += (i == 0 ? "" : ", ") + c_type(func.type->argument_types[i]) + " " + std::string(interner.name(func.parameter_asm_names[i]));
+	}
+	auto signature = "static " + c_type(func.return_type) + " " + name + "(" + (parameters.empty() ? "void" : parameters) + ")";
+	c_out.prototypes += signature + ";\n";
+
+	c_out.current_function = &func;
+	c_out.body = &c_out.functions;
+	c_out.line(signature + " {");
+	generate_c_block(func.body);
+	// (like in MCASM, not returning anything from a function that returns something isn't an error, it just has to give back something)
+	bool returns = !func.body.statements.empty() && func.body.statements.back()->kind == statement_kind::return_;
+	if (func.return_type != void_type && !returns) {
+		c_out.depth++;
+		c_out.line("return (" + c_type(func.return_type) + "){0};");
+		c_out.depth--;
+	}
+	c_out.line("}\n");
+}
+
+// the whole program as C
+static std::string generate_c(const block& program) {
+	find_c_declarations(program, nullptr);
+	for (auto class_type : c_out.classes) {
+		auto name = c_type_name(class_type, "class_" + class_type->name);
+		c_out.class_declarations += "typedef struct " + name + " " + name + ";\n";
+	}
+	for (auto class_type : c_out.classes) define_c_struct(class_type);
+
+	// functions first, so it's known which of the main script's variables they use by the time main() declares them
+	for (auto func : c_out.all_functions) generate_c_function(*func);
+
+	std::string main_function = "int main(void) {\n";
+	c_out.current_function = nullptr;
+	c_out.body = &main_function;
+	generate_c_block(program);
+	main_function += "\treturn 0;\n}\n";
+
+	std::string text = c_prelude;
+	for (auto section : { &c_out.class_declarations, &c_out.types, &c_out.globals, &c_out.prototypes }) {
+		if (!section->empty()) text += "\n" + *section;
+	}
+	return text + "\n" + c_out.functions + main_function;
+}
+
+// OPTIMIZER CHECKS
+
+// runs each MCASM file as it's written and after optimize(), and checks that both print the same thing, and what its "; expect: ..." lines say they should if it has any. (assembled with function_values, since it only ever runs in mcvm)
+// returns how many didn't
+static int check_optimizer(const std::vector<std::string>& paths) {
+	auto trim = [](std::string_view s) {
+		while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+		while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+		return s;
+	};
+	auto run = [](const mcasm_program& program) {
+		std::ostringstream output;
+		try {
+			run_bytecode(assemble(program.to_text(), true), output);
+		}
+		catch (std::runtime_error& error) {
+			output << "runtime error: " << error.what() << "\n";
+		}
+		return output.str();
+	};
+
+	int failed = 0;
+	for (auto& path : paths) {
+		try {
+			source_file file(path);
+			std::string_view text = file.text();
+
+			std::string expected;
+			constexpr std::string_view expect = "; expect:";
+			for (size_t at = text.find(expect); at != std::string_view::npos; at = text.find(expect, at + 1)) {
+				auto line = text.substr(at + expect.size());
+				expected += trim(line.substr(0, line.find('\n')));
+				expected += "\n";
+			}
+
+			auto program = parse_mcasm(text);
+			std::string before = run(program);
+			optimize(program);
+			std::string after = run(program);
+
+			if (before == after && (expected.empty() || after == expected)) {
+				std::cout << "ok " << path << "\n";
+				continue;
+			}
+			std::cout << "FAILED " << path << "\n";
+			if (!expected.empty()) std::cout << "expected:\n" << expected;
+			std::cout << "before optimizing:\n" << before << "after optimizing:\n" << after << "optimized code:" << program.to_text();
+		}
+		catch (std::exception& error) {
+			std::cout << "FAILED " << path << ": " << error.what() << "\n";
+		}
+		failed++;
+	}
+	std::cout << paths.size() - failed << "/" << paths.size() << " passed\n";
+	return failed;
+}
+
+int main(int nargs, const char** args) {
+	// "--check a.mcasm b.mcasm ..." checks the optimizer on hand-written MCASM instead of compiling anything (see tests/)
+	if (nargs >= 2 && std::string_view(args[1]) == "--check") {
+		return check_optimizer(std::vector<std::string>(args + 2, args + nargs)) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	// "--run" runs the compiled program once it's assembled. (it's not by default, since nothing stops it if it never ends)
+	// "--function-values" assembles it in the format mcvm needs to run programs that use functions as values, instead of mcasm/main.py's (see assemble())
+	bool run = false, function_values = false;
+	for (int a = 1; a < nargs; a++) {
+		std::string_view option = args[a];
+		if (option == "--run") run = true;
+		else if (option == "--function-values") function_values = true;
+		else {
+			std::cerr << "unknown option \"" << option << "\" (toola [--run] [--function-values], or toola --check a.mcasm ...)\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	block* program = parser.nodes.make<block>();
+	parser.taskStack.push_back(parsing_task_info { parsing_task::code_body, -1, program });
+	parser.push_scope(scope { .type = scope_type::main });
+	for (auto builtin : { void_type, i32_type, i32_ref_type, f64_type, f64_ref_type, bool_type, bool_ref_type, string_type, string_ref_type }) {
+		parser.symbols.declare_type(builtin->id, builtin);
+	}
 
 	
 
-	//try {
-		std::string current_token;
-		while ((current_token = get_next_non_empty_token(true)) != "") {
-			
+	source_file script("test1.tla");
+	tokenizer.src = script.text();
 
-			return_token(current_token);
+	//try {
+		while (!tokenizer.at_end()) {
 			assert(!parser.taskStack.empty());
 
 
@@ -1997,69 +2772,98 @@ int main(const char** args, int nargs) {
 		//throw exception;
 		//return EXIT_FAILURE;
 	//}
-	assert(src.empty());
+	assert(tokenizer.at_end());
 	assert(parser.taskStack.size() == 1);
 	assert(parser.scopeStack.size() == 1);
+	assert(parser.pending_functions.empty());
+
+	// the whole script is parsed, now generate it
 
-	std::cout << "\nOUTPUT:\n\n" << out;
+	// handle return statements
+	out.emit(opcode::dvar, { mcasm_operand::variable(return_asmvar), mcasm_operand::sint(0) });
+
+	generate_block(*program);
+
+	optimize(out);
+
+	std::string text = out.to_text();
+	std::cout << "\nOUTPUT:\n\n" << text;
 
 	std::string output_location = "assembly/test2.mcasm";
 
 	std::ofstream input(output_location);
 	assert(input.good());
-	input << out << "\n";
+	input << text;
 	input.flush();
 
 	std::cout << "\n\n";
-	
-	std::system(("python mcasm/main.py " + output_location).c_str());
+
+	auto executable = assemble(text, function_values);
+	std::ofstream executable_file("program.mce", std::ios::binary);
+	assert(executable_file.good());
+	executable_file.write(reinterpret_cast<const char*>(executable.data()), executable.size());
+	std::cout << "Assembled " << executable.size() << " B into program.mce" << (run ? "" : " (run it with: toola --run)") << "\n";
+
+	if (run) {
+		std::cout << "\nRunning it:\n";
+		auto start = std::chrono::steady_clock::now();
+		try {
+			run_bytecode(executable);
+		}
+		catch (std::runtime_error& error) {
+			std::cout << "runtime error: " << error.what() << "\n";
+		}
+		std::cout << "(ran in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms)\n";
+	}
+
+	// and the same program as C, for running natively
+	try {
+		std::string c_text = generate_c(*program);
+		std::ofstream c_file("program.c");
+		assert(c_file.good());
+		c_file << c_text;
+		std::cout << "\nWrote " << c_text.size() << " B of C into program.c (build it with: cc -O2 program.c -o program -lm)\n";
+	}
+	catch (std::runtime_error& error) {
+		std::cout << "\ncouldn't generate C: " << error.what() << "\n";
+	}
 
 	return EXIT_SUCCESS;
 }
 
-std::pair<std::string, std::string> funccall::retrieve_asm_value() {
-	auto [prep_asm, asm_funcname] = function->retrieve_asm_value();
-	std::string cfunc_asm = "\ncfunc " + asm_funcname + " ";
-	auto arg_types = parser.extract_arguments(function->get_type());
+mcasm_operand funccall::retrieve_asm_value() {
+	auto function_value = function->retrieve_asm_value();
+	get_type(); // (makes sure it's a function)
+	auto& arg_types = function->get_type()->argument_types;
 	if (arg_types.size() != args.size()) {
 		throw std::runtime_error(std::string("expected ") + std::to_string(arg_types.size()) + " args, got " + std::to_string(args.size()) + " args instead");
 	}
-	if (arg_types.size() == 0) {
-		cfunc_asm += "null";
-	}
-	else {
-		for (int i = 0; i < arg_types.size(); i++) {
-			// try to convert each arg to the desired type
-			//auto [prepcode, arglocationname] = args[i]->retrieve_asmvar();
-			if (arg_types[i]->pass_by_reference) { // then this is pass by reference; can't do any conversions, must be exact type
-				auto [prepcode, arglocationname] = args[i]->retrieve_asm_value();
-				if (arg_types[i] != args[i]->get_type()) {
-					throw std::runtime_error(std::string("error: mismatched types at argument #" + std::to_string(i + 1)));
-				}
 
-				prep_asm += prepcode;
-				cfunc_asm += "sym:" + arglocationname;
+	std::vector<mcasm_operand> arguments;
+	for (int i = 0; i < arg_types.size(); i++) {
+		// try to convert each arg to the desired type
+		if (arg_types[i]->pass_by_reference) { // then this is pass by reference; can't do any conversions, must be exact type
+			auto argument = args[i]->retrieve_asm_value();
+			if (arg_types[i] != args[i]->get_type()) {
+				throw std::runtime_error(std::string("error: mismatched types at argument #" + std::to_string(i + 1)));
 			}
-			else
-			{
-				auto [prepcode, arglocationname] = args[i]->retrieve_asm_value_copy();
-				auto conversion_asm = implicit_convert_to_type(arglocationname, arg_types[i], args[i]->get_type());
-				if (!conversion_asm.has_value()) {
-					throw std::runtime_error(std::string("error: mismatched types at argument #" + std::to_string(i + 1) + " and no valid implicit conversion exists"));
-				}
-
-				prep_asm += prepcode + *conversion_asm;
-				cfunc_asm += arglocationname;
+			arguments.push_back(argument);
+		}
+		else
+		{
+			auto converted = implicit_convert_to_type(args[i]->retrieve_asm_value_copy(), args[i]->get_type(), arg_types[i]);
+			if (!converted.has_value()) {
+				throw std::runtime_error(std::string("error: mismatched types at argument #" + std::to_string(i + 1) + " and no valid implicit conversion exists"));
 			}
-
-			cfunc_asm += "/";
+			arguments.push_back(*converted);
 		}
-		cfunc_asm.pop_back();
 	}
-	return std::make_pair(prep_asm + cfunc_asm, return_asmvar);
+
+	out.emit(opcode::cfunc, { function_value.as_variable(), out.arguments(std::move(arguments)) });
+	return mcasm_operand::value_of(return_asmvar);
 }
 
-varname::varname(std::string avn, type_info_ type, std::string svn) :
+varname::varname(symbol_id avn, type_info_ type, std::string svn) :
 	symname(svn),
 	type(type),
 	asmvarname(avn)
@@ -2068,24 +2872,10 @@ varname::varname(std::string avn, type_info_ type, std::string svn) :
 
 type_info_ operand::get_referenceless_type() {
 	auto t = get_type();
-	if (t->pass_by_reference) {
-		std::string s = t->name;
-		s.pop_back();
-		return parser.is_type(s);
-	}
-	else {
-		return t;
-	}
+	return t->pass_by_reference ? t->counterpart : t;
 }
 
 type_info_ operand::get_reference_type() {
 	auto t = get_type();
-	if (t->pass_by_reference) {
-		return t;
-	}
-	else {
-		std::string s = t->name;
-		s += "&";
-		return parser.is_type(s);
-	}
+	return t->pass_by_reference ? t : t->counterpart;
 }
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "mcasm.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <stdexcept>
+
+static constexpr std::array<std::string_view, static_cast<size_t>(opcode::endfunc) + 1> opcode_names = {
+	"dvar", "cvar", "jmp",
+	"sje", "sjne", "sjg", "sjge", "sjl", "sjle",
+	"uje", "ujne", "ujg", "ujge", "ujl", "ujle",
+	"fje", "fjne", "fjg", "fjge", "fjl", "fjle",
+	"dje", "djne", "djg", "djge", "djl", "djle",
+	"dfunc", "cfunc", "cabi",
+	"garrl", "garr", "sarr", "aarr", "iarr", "rarr",
+	"s2u", "s2f", "s2d", "s2str", "s2sym", "u2s", "u2f", "u2d", "u2str", "u2sym",
+	"f2s", "f2u", "f2d", "f2str", "d2s", "d2u", "d2f", "d2str",
+	"sym2s", "sym2u",
+	"sadd", "ssub", "smul", "sdiv",
+	"uadd", "usub", "umul", "udiv",
+	"fadd", "fsub", "fmul", "fdiv",
+	"dadd", "dsub", "dmul", "ddiv",
+	"label", "endfunc",
+};
+
+std::string_view opcode_name(opcode op) {
+	return opcode_names[static_cast<size_t>(op)];
+}
+
+mcasm_operand mcasm_operand::as_variable() const {
+	assert(kind == kind_t::symbol || kind == kind_t::name);
+	return variable(name);
+}
+
+void mcasm_program::emit(opcode op, std::initializer_list<mcasm_operand> operands, symbol_id comment) {
+	assert(operands.size() <= 4);
+	instruction& i = code.emplace_back(instruction{ .op = op, .operand_count = static_cast<uint8_t>(operands.size()), .comment = comment });
+	std::copy(operands.begin(), operands.end(), i.operands.begin());
+}
+
+mcasm_operand mcasm_program::string_constant(std::string bytes) {
+	mcasm_operand o;
+	o.kind = mcasm_operand::kind_t::str;
+	o.index = static_cast<uint32_t>(strings.size());
+	strings.push_back(std::move(bytes));
+	return o;
+}
+
+mcasm_operand mcasm_program::parameters(std::vector<mcasm_operand> names) {
+	mcasm_operand o;
+	o.kind = mcasm_operand::kind_t::parameters;
+	o.index = static_cast<uint32_t>(lists.size());
+	lists.push_back(std::move(names));
+	return o;
+}
+
+mcasm_operand mcasm_program::arguments(std::vector<mcasm_operand> values) {
+	mcasm_operand o;
+	o.kind = mcasm_operand::kind_t::arguments;
+	o.index = static_cast<uint32_t>(lists.size());
+	lists.push_back(std::move(values));
+	return o;
+}
+
+// appends straight into one big buffer, numbers included, so no temporary strings get made along the way
+class mcasm_writer {
+public:
+	explicit mcasm_writer(const mcasm_program& p) : program(p) {}
+
+	std::string buffer;
+
+	void write(std::string_view text) { buffer.append(text); }
+
+	void write(int32_t value) {
+		char digits[16];
+		buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+	}
+
+	// shortest text that reads back as the same double, but always with a "." so it still looks like one
+	void write(double value) {
+		char digits[32];
+		auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+		std::string_view text(digits, end - digits);
+		buffer.append(text);
+		if (text.find_first_of(".einf") == std::string_view::npos) buffer.append(".0");
+	}
+
+	void write(const mcasm_operand& o) {
+		using kind = mcasm_operand::kind_t;
+		switch (o.kind) {
+		case kind::none:
+			assert(false);
+			break;
+		case kind::name:
+		case kind::label:
+		case kind::abi:
+			write(interner.name(o.name));
+			break;
+		case kind::symbol:
+			write("sym:");
+			write(interner.name(o.name));
+			break;
+		case kind::sint:
+			write("sint:");
+			write(o.int_value);
+			break;
+		case kind::dbl:
+			write("dbl:");
+			write(o.float_value);
+			break;
+		case kind::str: {
+			write("str:");
+			auto& bytes = program.strings[o.index];
+			if (bytes.empty()) write("null");
+			for (size_t i = 0; i < bytes.size(); i++) {
+				if (i != 0) write(",");
+				write(static_cast<int32_t>(static_cast<uint8_t>(bytes[i])));
+			}
+			break;
+		}
+		case kind::empty_array:
+			write("arr:null");
+			break;
+		case kind::parameters:
+		case kind::arguments: {
+			auto& elements = program.lists[o.index];
+			if (elements.empty()) write("null");
+			for (size_t i = 0; i < elements.size(); i++) {
+				if (i != 0) write("/");
+				write(elements[i]);
+				if (o.kind == kind::parameters) write(":sym");
+			}
+			break;
+		}
+		}
+	}
+
+	void write(const instruction& i) {
+		if (i.op == opcode::dfunc) write("\n"); // (a blank line around each function)
+		write("\n");
+		write(opcode_name(i.op));
+		for (size_t j = 0; j < i.operand_count; j++) {
+			write(" ");
+			write(i.operands[j]);
+		}
+		if (i.comment != no_symbol) {
+			write(" ;");
+			write(interner.name(i.comment));
+		}
+		if (i.op == opcode::endfunc) write("\n");
+	}
+
+private:
+	const mcasm_program& program;
+};
+
+std::string mcasm_program::to_text() const {
+	mcasm_writer writer(*this);
+	writer.buffer.reserve(code.size() * 24);
+	for (auto& i : code) writer.write(i);
+	writer.write("\n");
+	return std::move(writer.buffer);
+}
+
+// reads MCASM text a line at a time. an operand's kind depends on which instruction it's in and where (like operand_kinds in assembler.cpp)
+class mcasm_reader {
+public:
+	explicit mcasm_reader(mcasm_program& p) : program(p) {}
+
+	void read_line(std::string_view line) {
+		symbol_id comment = no_symbol;
+		if (auto semicolon = line.find(';'); semicolon != std::string_view::npos) {
+			auto text = trim(line.substr(semicolon + 1));
+			if (!text.empty()) comment = interner.intern(text);
+			line = line.substr(0, semicolon);
+		}
+
+		std::vector<std::string_view> words;
+		while (!(line = trim(line)).empty()) {
+			auto end = line.find_first_of(" \t");
+			words.push_back(line.substr(0, end));
+			line = end == std::string_view::npos ? std::string_view() : line.substr(end);
+		}
+		if (words.empty()) return;
+
+		auto found = std::find(opcode_names.begin(), opcode_names.end(), words[0]);
+		if (found == opcode_names.end()) throw std::runtime_error("unknown instruction \"" + std::string(words[0]) + "\"");
+		auto op = static_cast<opcode>(found - opcode_names.begin());
+		if (words.size() - 1 != operand_count(op)) throw std::runtime_error(std::string(words[0]) + " takes " + std::to_string(operand_count(op)) + " operands, not " + std::to_string(words.size() - 1));
+
+		instruction& i = program.code.emplace_back(instruction{ .op = op, .operand_count = static_cast<uint8_t>(words.size() - 1), .comment = comment });
+		for (size_t j = 1; j < words.size(); j++) i.operands[j - 1] = read_operand(op, j - 1, words[j]);
+	}
+
+private:
+	mcasm_program& program;
+
+	static std::string_view trim(std::string_view s) {
+		while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r')) s.remove_prefix(1);
+		while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+		return s;
+	}
+
+	static size_t operand_count(opcode op) {
+		if (is_conditional_jump(op)) return 3;
+		if (is_conversion(op)) return 2;
+		if (is_arithmetic(op)) return op == opcode::sdiv || op == opcode::udiv || op == opcode::fdiv || op == opcode::ddiv ? 4 : 3;
+		switch (op) {
+		case opcode::jmp: case opcode::label: return 1;
+		case opcode::garr: case opcode::sarr: case opcode::iarr: return 3;
+		case opcode::endfunc: return 0;
+		default: return 2;
+		}
+	}
+
+	static int32_t read_int(std::string_view text) {
+		int32_t value = 0;
+		auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (error != std::errc() || end != text.data() + text.size()) throw std::runtime_error("malformed number \"" + std::string(text) + "\"");
+		return value;
+	}
+
+	mcasm_operand read_operand(opcode op, size_t position, std::string_view text) {
+		using kind = mcasm_operand::kind_t;
+		if ((op == opcode::jmp || op == opcode::label || is_conditional_jump(op)) && position == 0) return mcasm_operand::label_name(interner.intern(text));
+		if (op == opcode::cabi && position == 0) return mcasm_operand::abi(interner.intern(text));
+		if ((op == opcode::dfunc || op == opcode::cfunc || op == opcode::cabi) && position == 1) {
+			std::vector<mcasm_operand> elements;
+			while (text != "null" && !text.empty()) {
+				auto end = text.find('/');
+				auto element = text.substr(0, end);
+				if (op == opcode::dfunc) {
+					if (!element.ends_with(":sym")) throw std::runtime_error("malformed parameter \"" + std::string(element) + "\"");
+					elements.push_back(mcasm_operand::variable(interner.intern(element.substr(0, element.size() - 4))));
+				}
+				else elements.push_back(read_value(element));
+				text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+			}
+			return op == opcode::dfunc ? program.parameters(std::move(elements)) : program.arguments(std::move(elements));
+		}
+		if (text.find(':') == std::string_view::npos) return mcasm_operand::variable(interner.intern(text));
+		auto value = read_value(text);
+		assert(value.kind != kind::none);
+		return value;
+	}
+
+	// only the kinds of values codegen makes
+	mcasm_operand read_value(std::string_view text) {
+		auto colon = text.find(':');
+		if (colon == std::string_view::npos) throw std::runtime_error("expected a value, not \"" + std::string(text) + "\"");
+		auto type = text.substr(0, colon), rest = text.substr(colon + 1);
+		if (type == "sym") return mcasm_operand::value_of(interner.intern(rest));
+		if (type == "sint") return mcasm_operand::sint(read_int(rest));
+		if (type == "dbl") {
+			double value = 0;
+			auto [end, error] = std::from_chars(rest.data(), rest.data() + rest.size(), value);
+			if (error != std::errc() || end != rest.data() + rest.size()) throw std::runtime_error("malformed number \"" + std::string(rest) + "\"");
+			return mcasm_operand::dbl(value);
+		}
+		if (type == "str") {
+			std::string bytes;
+			while (rest != "null" && !rest.empty()) {
+				auto end = rest.find(',');
+				bytes.push_back(static_cast<char>(read_int(rest.substr(0, end))));
+				rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+			}
+			return program.string_constant(std::move(bytes));
+		}
+		if (text == "arr:null") return mcasm_operand::empty_array();
+		throw std::runtime_error("can't read \"" + std::string(text) + "\", only values codegen makes");
+	}
+};
+
+mcasm_program parse_mcasm(std::string_view text) {
+	mcasm_program program;
+	mcasm_reader reader(program);
+	while (!text.empty()) {
+		auto end = text.find('\n');
+		reader.read_line(text.substr(0, end));
+		text = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+	}
+	return program;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "interner.h"
+
+// MCASM as data instead of text. codegen appends instructions to an mcasm_program, and it's only turned into text once, at the very end (see mcasm_program::to_text).
+// names (variables, functions, labels) are interned in the same string_interner as the script's names, so operands are small and comparing them is cheap.
+
+// same order as OPCODES in mcasm/mcasm/grammar.py, so the values are the bytecode's opcodes
+enum class opcode : uint8_t {
+	dvar, cvar, jmp,
+	sje, sjne, sjg, sjge, sjl, sjle,
+	uje, ujne, ujg, ujge, ujl, ujle,
+	fje, fjne, fjg, fjge, fjl, fjle,
+	dje, djne, djg, djge, djl, djle,
+	dfunc, cfunc, cabi,
+	garrl, garr, sarr, aarr, iarr, rarr,
+	s2u, s2f, s2d, s2str, s2sym, u2s, u2f, u2d, u2str, u2sym,
+	f2s, f2u, f2d, f2str, d2s, d2u, d2f, d2str,
+	sym2s, sym2u,
+	sadd, ssub, smul, sdiv,
+	uadd, usub, umul, udiv,
+	fadd, fsub, fmul, fdiv,
+	dadd, dsub, dmul, ddiv,
+
+	// directives, which aren't instructions and don't have an opcode in the bytecode
+	label,
+	endfunc,
+};
+
+constexpr size_t instruction_opcode_count = static_cast<size_t>(opcode::label);
+
+constexpr bool is_conditional_jump(opcode op) { return op >= opcode::sje && op <= opcode::djle; }
+constexpr bool is_conversion(opcode op) { return op >= opcode::s2u && op <= opcode::sym2u; }
+constexpr bool is_arithmetic(opcode op) { return op >= opcode::sadd && op <= opcode::ddiv; }
+
+// the conditional jump that jumps exactly when the given one doesn't (sjl for sjge...).
+// for floats that's only true of je and jne, since nothing is less than, greater than or equal to NaN.
+constexpr opcode inverse_jump(opcode op) {
+	constexpr uint8_t inverses[] = { 1, 0, 5, 4, 3, 2 }; // (each type's jumps go je, jne, jg, jge, jl, jle)
+	uint8_t i = static_cast<uint8_t>(op) - static_cast<uint8_t>(opcode::sje);
+	return static_cast<opcode>(static_cast<uint8_t>(opcode::sje) + i / 6 * 6 + inverses[i % 6]);
+}
+
+std::string_view opcode_name(opcode op);
+
+// the types of values in the bytecode, same order as ValueType in mcasm/mcasm/grammar.py
+enum class value_type : uint8_t { sint, uint, flt, dbl, str, sym, arr };
+
+struct mcasm_operand {
+	enum class kind_t : uint8_t {
+		none,
+		name, // a variable or function where the instruction wants a symbol, written bare ("v3")
+		symbol, // the value of a variable or function, "sym:v3"
+		sint, // "sint:-2"
+		dbl, // "dbl:1.5"
+		str, // "str:104,105", index is into mcasm_program::strings
+		empty_array, // "arr:null"
+		label, // written bare
+		parameters, // dfunc's, "v3:sym/v4:sym" (or "null"), index is into mcasm_program::lists
+		arguments, // cfunc's and cabi's, "sym:v3/sint:1" (or "null"), index is into mcasm_program::lists
+		abi, // cabi's function, "logi"
+	};
+
+	kind_t kind = kind_t::none;
+	union {
+		symbol_id name = no_symbol; // name, symbol, label, abi
+		int32_t int_value; // sint
+		double float_value; // dbl
+		uint32_t index; // str, parameters, arguments
+	};
+
+	static mcasm_operand variable(symbol_id n) { mcasm_operand o; o.kind = kind_t::name; o.name = n; return o; }
+	static mcasm_operand value_of(symbol_id n) { mcasm_operand o; o.kind = kind_t::symbol; o.name = n; return o; }
+	static mcasm_operand sint(int32_t v) { mcasm_operand o; o.kind = kind_t::sint; o.int_value = v; return o; }
+	static mcasm_operand dbl(double v) { mcasm_operand o; o.kind = kind_t::dbl; o.float_value = v; return o; }
+	static mcasm_operand empty_array() { mcasm_operand o; o.kind = kind_t::empty_array; return o; }
+	static mcasm_operand label_name(symbol_id n) { mcasm_operand o; o.kind = kind_t::label; o.name = n; return o; }
+	static mcasm_operand abi(symbol_id n) { mcasm_operand o; o.kind = kind_t::abi; o.name = n; return o; }
+
+	// a value that's written out in full, rather than kept in a variable
+	bool is_immediate() const { return kind == kind_t::sint || kind == kind_t::dbl || kind == kind_t::str || kind == kind_t::empty_array; }
+
+	// the variable a symbol value is the value of (so "sym:v3" gives "v3")
+	mcasm_operand as_variable() const;
+};
+
+struct instruction {
+	opcode op;
+	uint8_t operand_count = 0;
+	std::array<mcasm_operand, 4> operands{};
+	symbol_id comment = no_symbol; // written after the instruction as ";comment"
+
+	const mcasm_operand& operator[](size_t i) const { return operands[i]; }
+	mcasm_operand& operator[](size_t i) { return operands[i]; }
+};
+
+class mcasm_program {
+public:
+	std::vector<instruction> code; // in order
+	std::vector<std::string> strings; // the bytes of str operands
+	std::vector<std::vector<mcasm_operand>> lists; // the elements of parameters and arguments operands
+
+	void emit(opcode op, std::initializer_list<mcasm_operand> operands, symbol_id comment = no_symbol);
+
+	mcasm_operand string_constant(std::string bytes);
+	mcasm_operand parameters(std::vector<mcasm_operand> names); // of kind name
+	mcasm_operand arguments(std::vector<mcasm_operand> values);
+
+	// the whole program as MCASM text, written in one pass
+	std::string to_text() const;
+};
+
+// reads MCASM text back into an mcasm_program, for checking the passes on hand-written MCASM. only takes the kinds of values codegen makes (no uint:, flt: or other types' nulls).
+// throws std::runtime_error if it can't
+mcasm_program parse_mcasm(std::string_view text);
@@ -0,0 +1,777 @@
+#include "mcvm.h"
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <ostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "mcasm.h"
+
+// computed goto is a GCC and clang extension
+#if defined(__GNUC__)
+#define MCVM_THREADED_DISPATCH 1
+#else
+#define MCVM_THREADED_DISPATCH 0
+#endif
+
+// in the same order as opcode
+#define MCVM_OPCODES(X) \
+	X(dvar) X(cvar) X(jmp) \
+	X(sje) X(sjne) X(sjg) X(sjge) X(sjl) X(sjle) \
+	X(uje) X(ujne) X(ujg) X(ujge) X(ujl) X(ujle) \
+	X(fje) X(fjne) X(fjg) X(fjge) X(fjl) X(fjle) \
+	X(dje) X(djne) X(djg) X(djge) X(djl) X(djle) \
+	X(dfunc) X(cfunc) X(cabi) \
+	X(garrl) X(garr) X(sarr) X(aarr) X(iarr) X(rarr) \
+	X(s2u) X(s2f) X(s2d) X(s2str) X(s2sym) X(u2s) X(u2f) X(u2d) X(u2str) X(u2sym) \
+	X(f2s) X(f2u) X(f2d) X(f2str) X(d2s) X(d2u) X(d2f) X(d2str) \
+	X(sym2s) X(sym2u) \
+	X(sadd) X(ssub) X(smul) X(sdiv) \
+	X(uadd) X(usub) X(umul) X(udiv) \
+	X(fadd) X(fsub) X(fmul) X(fdiv) \
+	X(dadd) X(dsub) X(dmul) X(ddiv) \
+	X(label) X(endfunc)
+
+struct vm_value;
+
+// a reference counted pointer to a value. (not std::shared_ptr, which counts atomically, and copying these around is most of what the interpreter does)
+class value_ref {
+public:
+	value_ref() = default;
+	explicit value_ref(vm_value* value);
+	value_ref(const value_ref& other) : value_ref(other.value) {}
+	value_ref(value_ref&& other) noexcept : value(std::exchange(other.value, nullptr)) {}
+	value_ref& operator=(value_ref other) noexcept { std::swap(value, other.value); return *this; }
+	~value_ref();
+
+	vm_value* operator->() const { return value; }
+	vm_value& operator*() const { return *value; }
+	explicit operator bool() const { return value != nullptr; }
+
+private:
+	vm_value* value = nullptr;
+};
+
+struct vm_value {
+	uint32_t references = 0;
+	value_type type = value_type::sint;
+	union {
+		int32_t s = 0; // sint and sym
+		uint32_t u;
+		float f;
+		double d;
+	};
+	std::string str;
+	std::vector<value_ref> elements; // arr's
+
+	static value_ref make() { return value_ref(new vm_value); }
+};
+
+value_ref::value_ref(vm_value* v) : value(v) {
+	if (value) value->references++;
+}
+
+value_ref::~value_ref() {
+	if (value && --value->references == 0) delete value;
+}
+
+static std::string type_name(value_type type) {
+	constexpr const char* names[] = { "sint", "uint", "flt", "dbl", "str", "sym", "arr" };
+	return names[static_cast<size_t>(type)];
+}
+
+template <typename I, typename F>
+static I to_integer(F f) {
+	if (!(f >= static_cast<F>(std::numeric_limits<I>::min()) && f < static_cast<F>(std::numeric_limits<I>::max()) + 1)) throw std::runtime_error("can't convert " + std::to_string(f) + " to an integer");
+	return static_cast<I>(f);
+}
+
+// a number value as the given type, converting it if it's another type of number
+template <typename T>
+static T number(const vm_value& v) {
+	switch (v.type) {
+	case value_type::sint:
+	case value_type::sym:
+		return static_cast<T>(v.s);
+	case value_type::uint:
+		return static_cast<T>(v.u);
+	case value_type::flt:
+		if constexpr (std::is_integral_v<T>) return to_integer<T>(v.f);
+		else return static_cast<T>(v.f);
+	case value_type::dbl:
+		if constexpr (std::is_integral_v<T>) return to_integer<T>(v.d);
+		else return static_cast<T>(v.d);
+	default:
+		throw std::runtime_error("expected a number, got a " + type_name(v.type));
+	}
+}
+
+// writing a value into another one. (strings and arrays let go of what they had)
+static void clear(vm_value& v) {
+	if (v.type == value_type::str) v.str.clear();
+	if (v.type == value_type::arr) v.elements.clear();
+}
+static void store(vm_value& v, int32_t s, value_type type = value_type::sint) { clear(v); v.type = type; v.s = s; }
+static void store(vm_value& v, uint32_t u) { clear(v); v.type = value_type::uint; v.u = u; }
+static void store(vm_value& v, float f) { clear(v); v.type = value_type::flt; v.f = f; }
+static void store(vm_value& v, double d) { clear(v); v.type = value_type::dbl; v.d = d; }
+static void store(vm_value& v, std::string str) { v.elements.clear(); v.type = value_type::str; v.str = std::move(str); }
+
+static void store(vm_value& v, const vm_value& from) {
+	if (&v == &from) return;
+	v.type = from.type;
+	v.d = from.d; // (copies the whole union)
+	v.str = from.str;
+	v.elements = from.elements; // (arrays are copied, the values in them aren't)
+}
+
+template <typename T>
+static std::string number_text(T v) {
+	char digits[32];
+	return std::string(digits, std::to_chars(digits, digits + sizeof(digits), v).ptr);
+}
+
+static std::string text(const vm_value& v) {
+	switch (v.type) {
+	case value_type::sint: case value_type::sym: return number_text(v.s);
+	case value_type::uint: return number_text(v.u);
+	case value_type::flt: return number_text(v.f);
+	case value_type::dbl: return number_text(v.d);
+	case value_type::str: return v.str;
+	case value_type::arr: {
+		std::string t = "[";
+		for (size_t i = 0; i < v.elements.size(); i++) t += (i == 0 ? "" : ", ") + text(*v.elements[i]);
+		return t + "]";
+	}
+	}
+	return "";
+}
+
+// operands are the variable's symbol, or an index into constants with this bit set
+constexpr uint32_t constant_operand = 1u << 31;
+
+struct vm_instruction {
+	opcode op;
+	uint32_t target = 0; // jumps: the instruction to jump to. dfunc: its function. cfunc and cabi: the index of their arguments in lists.
+	std::array<uint32_t, 4> operands{}; // (cfunc's second is 1 if its first is a variable holding the function, rather than the function)
+};
+
+struct vm_constant {
+	vm_value value;
+	std::vector<uint32_t> elements; // an array's, as operands (since they can be variables)
+};
+
+struct vm_function {
+	uint32_t body = 0; // its first instruction
+	uint32_t end = 0; // the endfunc after its last one, which returns
+	std::vector<std::pair<uint32_t, value_type>> parameters;
+	std::vector<uint32_t> locals; // the variables only it uses, including its parameters. they're put back how they were when it returns, so it can call itself
+	int32_t parent = -1; // the function it's defined in, -1 for the top level
+};
+
+class bytecode_reader {
+public:
+	bytecode_reader(const std::vector<uint8_t>& b) : bytes(b) {}
+
+	const std::vector<uint8_t>& bytes;
+	size_t at = 0;
+
+	uint8_t byte() {
+		if (at >= bytes.size()) throw std::runtime_error("bytecode ends in the middle of an instruction");
+		return bytes[at++];
+	}
+
+	uint64_t integer(size_t size) {
+		if (size > 8) throw std::runtime_error("integer in bytecode is too big");
+		uint64_t v = 0;
+		for (size_t i = 0; i < size; i++) v = v << 8 | byte();
+		return v;
+	}
+
+	uint64_t sized_unsigned() { return integer(byte()); }
+
+	int64_t sized_signed() {
+		size_t size = byte();
+		uint64_t v = integer(size);
+		if (size > 0 && size < 8 && (v >> (size * 8 - 1) & 1)) v |= ~uint64_t(0) << (size * 8); // (sign extend)
+		return static_cast<int64_t>(v);
+	}
+};
+
+class mcvm {
+public:
+	mcvm(const std::vector<uint8_t>& bytecode, std::ostream& output) : output(output) { decode(bytecode); }
+
+	void run();
+
+private:
+	std::ostream& output; // where cabi's log functions print to
+	std::vector<vm_instruction> code;
+	std::vector<vm_constant> constants;
+	std::vector<std::vector<uint32_t>> lists; // cfunc and cabi's arguments, as operands
+	std::vector<vm_function> functions;
+
+	std::vector<value_ref> variables; // what each variable is bound to, by symbol
+	std::vector<int32_t> defined_functions; // which of functions each function symbol is, -1 before its dfunc has run
+
+	struct frame {
+		uint32_t return_to;
+		uint32_t function;
+		size_t saved; // where its function's locals start in saved
+	};
+	std::vector<frame> frames;
+	std::vector<value_ref> saved; // what functions' locals were bound to before they were called
+
+	void decode(const std::vector<uint8_t>& bytecode);
+
+	// DECODING
+
+	// the symbol's slot, making room for it
+	uint32_t variable(int64_t symbol) {
+		if (symbol < 0 || symbol >= constant_operand) throw std::runtime_error("invalid symbol in bytecode");
+		if (symbol >= static_cast<int64_t>(variables.size())) variables.resize(symbol + 1);
+		return static_cast<uint32_t>(symbol);
+	}
+
+	// a function as a value, which is a sym holding its function symbol
+	uint32_t function_value(int64_t function_symbol) {
+		vm_constant c;
+		c.value.type = value_type::sym;
+		c.value.s = static_cast<int32_t>(function_symbol);
+		constants.push_back(std::move(c));
+		return static_cast<uint32_t>(constants.size() - 1) | constant_operand;
+	}
+
+	// a variable, or a function's value if it's ~its function symbol (see assembler.h)
+	uint32_t source(int64_t symbol) { return symbol < 0 ? function_value(~symbol) : variable(symbol); }
+
+	uint32_t read_value(bytecode_reader& r) {
+		auto type = static_cast<value_type>(r.byte());
+		size_t size = r.sized_unsigned();
+		size_t end = r.at + size;
+		if (type > value_type::arr || end > r.bytes.size()) throw std::runtime_error("invalid value in bytecode");
+
+		// a symbol is the value of that variable, or a function. (null is a single 0 byte, whatever the type)
+		if (type == value_type::sym) {
+			int32_t symbol = static_cast<int32_t>(r.integer(size));
+			return source(symbol);
+		}
+		vm_constant c;
+		c.value.type = type;
+		switch (type) {
+		case value_type::sint: c.value.s = size >= 4 ? static_cast<int32_t>(r.integer(4)) : 0; break;
+		case value_type::uint: c.value.u = size >= 4 ? static_cast<uint32_t>(r.integer(4)) : 0; break;
+		case value_type::flt: c.value.f = size >= 4 ? std::bit_cast<float>(static_cast<uint32_t>(r.integer(4))) : 0; break;
+		case value_type::dbl: c.value.d = size >= 8 ? std::bit_cast<double>(r.integer(8)) : 0; break;
+		case value_type::str:
+			if (!(size == 1 && r.bytes[r.at] == 0)) c.value.str.assign(r.bytes.begin() + r.at, r.bytes.begin() + end);
+			break;
+		case value_type::arr:
+			c.elements = read_values(r);
+			break;
+		default:
+			break;
+		}
+		r.at = end;
+		constants.push_back(std::move(c));
+		return static_cast<uint32_t>(constants.size() - 1) | constant_operand;
+	}
+
+	std::vector<uint32_t> read_values(bytecode_reader& r) {
+		std::vector<uint32_t> values(r.sized_unsigned());
+		for (auto& v : values) v = read_value(r);
+		return values;
+	}
+
+	uint32_t read_uint(bytecode_reader& r) {
+		auto o = read_value(r);
+		if (!(o & constant_operand)) throw std::runtime_error("expected a uint in bytecode");
+		return number<uint32_t>(constants[o & ~constant_operand].value);
+	}
+
+	// RUNNING
+
+	vm_value& value_of(uint32_t o) {
+		if (o & constant_operand) return constants[o & ~constant_operand].value;
+		auto& v = variables[o];
+		if (!v) throw std::runtime_error("variable " + std::to_string(o) + " was used before it was defined");
+		return *v;
+	}
+
+	// a new value, that's a copy of the operand's
+	value_ref copy_of(uint32_t o) {
+		auto v = vm_value::make();
+		if (o & constant_operand) {
+			auto& c = constants[o & ~constant_operand];
+			store(*v, c.value);
+			for (auto element : c.elements) v->elements.push_back(reference_to(element));
+		}
+		else {
+			store(*v, value_of(o));
+		}
+		return v;
+	}
+
+	// the operand's value itself if it's a variable, otherwise a new one
+	value_ref reference_to(uint32_t o) {
+		if (o & constant_operand) return copy_of(o);
+		value_of(o); // (makes sure it's defined)
+		return variables[o];
+	}
+
+	// where an instruction's result goes, which is the value the variable is bound to
+	vm_value& result(uint32_t o) {
+		auto& v = variables[o];
+		if (!v) v = vm_value::make();
+		return *v;
+	}
+
+	std::vector<value_ref>& array(uint32_t o) {
+		auto& v = value_of(o);
+		if (v.type != value_type::arr) throw std::runtime_error("expected an array, got a " + type_name(v.type));
+		return v.elements;
+	}
+
+	size_t index(std::vector<value_ref>& elements, uint32_t o, bool end_allowed = false) {
+		int64_t i = number<int64_t>(value_of(o));
+		if (i < 0 || i > static_cast<int64_t>(elements.size()) || (i == static_cast<int64_t>(elements.size()) && !end_allowed)) {
+			throw std::runtime_error("array index " + std::to_string(i) + " is out of range");
+		}
+		return static_cast<size_t>(i);
+	}
+
+	void call(uint32_t function_symbol, const std::vector<uint32_t>& arguments, uint32_t& pc);
+	void log(uint32_t abi, const std::vector<uint32_t>& arguments);
+};
+
+void mcvm::decode(const std::vector<uint8_t>& bytecode) {
+	bytecode_reader r(bytecode);
+
+	// functions being decoded, innermost last, and how many more instructions are in each of them
+	struct open_function {
+		uint32_t function;
+		uint64_t remaining;
+	};
+	std::vector<open_function> open;
+	std::vector<int32_t> owner(code.size()); // the innermost function each instruction's in, -1 for the top level
+	std::vector<size_t> offsets; // each instruction's byte index (the endfuncs have the one after their function)
+	std::vector<bool> defined; // variables already defined somewhere before, by symbol
+
+	// a variable is local to the function it's first defined in
+	auto define = [&](uint32_t v) {
+		if (v >= defined.size()) defined.resize(v + 1);
+		if (defined[v]) return;
+		defined[v] = true;
+		if (!open.empty()) functions[open.back().function].locals.push_back(v);
+	};
+	auto end_functions = [&]() {
+		while (!open.empty() && open.back().remaining == 0) {
+			functions[open.back().function].end = static_cast<uint32_t>(code.size());
+			code.push_back(vm_instruction{ .op = opcode::endfunc });
+			owner.push_back(static_cast<int32_t>(open.back().function));
+			offsets.push_back(r.at);
+			open.pop_back();
+		}
+	};
+
+	while (r.at < bytecode.size()) {
+		size_t offset = r.at;
+		auto op = static_cast<opcode>(r.byte());
+		if (op >= opcode::label) throw std::runtime_error("invalid opcode " + std::to_string(static_cast<int>(op)) + " in bytecode");
+		size_t size = r.sized_unsigned();
+		size_t end = r.at + size;
+
+		vm_instruction in{ .op = op };
+		auto& o = in.operands;
+		uint64_t function_size = 0; // (dfunc's)
+		auto symbol = [&]() { return variable(r.sized_signed()); };
+
+		if (op == opcode::dvar) {
+			o[0] = symbol();
+			o[1] = read_value(r);
+			define(o[0]);
+		}
+		else if (op == opcode::cvar) {
+			o[0] = source(r.sized_signed());
+			o[1] = symbol();
+			define(o[1]);
+		}
+		else if (op == opcode::jmp || is_conditional_jump(op)) {
+			in.target = read_uint(r); // (a byte index for now)
+			if (op != opcode::jmp) {
+				o[0] = read_value(r);
+				o[1] = read_value(r);
+			}
+		}
+		else if (op == opcode::dfunc) {
+			o[0] = static_cast<uint32_t>(r.sized_signed()); // (a function symbol)
+			function_size = read_uint(r);
+			vm_function f;
+			f.parent = open.empty() ? -1 : static_cast<int32_t>(open.back().function);
+			for (uint64_t n = r.sized_unsigned(); n > 0; n--) {
+				auto p = symbol();
+				f.parameters.emplace_back(p, static_cast<value_type>(r.byte()));
+			}
+			in.target = static_cast<uint32_t>(functions.size());
+			functions.push_back(std::move(f));
+			for (auto& [p, type] : functions.back().parameters) define(p);
+			if (o[0] >= defined_functions.size()) defined_functions.resize(o[0] + 1, -1);
+		}
+		else if (op == opcode::cfunc || op == opcode::cabi) {
+			int64_t s = r.sized_signed(); // (a function symbol, or which ABI function)
+			if (op == opcode::cfunc && s < 0) {
+				o[0] = variable(~s);
+				o[1] = 1;
+			}
+			else {
+				o[0] = static_cast<uint32_t>(s);
+			}
+			in.target = static_cast<uint32_t>(lists.size());
+			lists.push_back(read_values(r));
+		}
+		else if (op == opcode::garrl || op == opcode::sym2s || op == opcode::sym2u) {
+			o[0] = symbol();
+			o[1] = symbol();
+		}
+		else if (op == opcode::garr) {
+			o[0] = symbol();
+			o[1] = read_value(r);
+			o[2] = symbol();
+		}
+		else if (op == opcode::sarr || op == opcode::aarr || op == opcode::iarr || op == opcode::rarr) {
+			o[0] = symbol();
+			o[1] = read_value(r);
+			if (op == opcode::sarr || op == opcode::iarr) o[2] = read_value(r);
+		}
+		else if (is_conversion(op)) {
+			o[0] = read_value(r);
+			o[1] = symbol();
+		}
+		else {
+			assert(is_arithmetic(op));
+			o[0] = read_value(r);
+			o[1] = read_value(r);
+			o[2] = symbol();
+			if (op == opcode::sdiv || op == opcode::udiv || op == opcode::fdiv || op == opcode::ddiv) o[3] = symbol();
+		}
+		if (r.at != end) throw std::runtime_error("instruction's size doesn't match its operands in bytecode");
+
+		for (auto& f : open) f.remaining--; // (each function's size counts the instructions in the ones inside it too)
+		owner.push_back(open.empty() ? -1 : static_cast<int32_t>(open.back().function));
+		offsets.push_back(offset);
+		code.push_back(in);
+		if (op == opcode::dfunc) {
+			functions[in.target].body = static_cast<uint32_t>(code.size());
+			open.push_back({ in.target, function_size });
+		}
+		end_functions();
+	}
+	if (!open.empty()) throw std::runtime_error("function in bytecode goes past the end of it");
+	code.push_back(vm_instruction{ .op = opcode::endfunc }); // (which stops the program)
+	owner.push_back(-1);
+	offsets.push_back(bytecode.size());
+
+	// jumps go to instruction indices instead of byte indices. a jump to right after the function it's in is a return, so it goes to its endfunc.
+	std::unordered_map<size_t, uint32_t> instruction_at;
+	for (uint32_t i = 0; i < code.size(); i++) {
+		if (code[i].op != opcode::endfunc) instruction_at.emplace(offsets[i], i);
+	}
+	for (uint32_t i = 0; i < code.size(); i++) {
+		auto& in = code[i];
+		if (in.op != opcode::jmp && !is_conditional_jump(in.op)) continue;
+		size_t target = in.target;
+		int32_t f = owner[i];
+		for (; f != -1; f = functions[f].parent) {
+			if (target == offsets[functions[f].end]) break;
+			if (target >= offsets[functions[f].body - 1] && target < offsets[functions[f].end]) { f = -2; break; } // (somewhere inside it)
+		}
+		if (f >= 0 || (f == -1 && target == bytecode.size())) {
+			in.target = f >= 0 ? functions[f].end : static_cast<uint32_t>(code.size() - 1);
+			continue;
+		}
+		auto found = instruction_at.find(target);
+		if (found == instruction_at.end()) throw std::runtime_error("jump to the middle of an instruction in bytecode");
+		in.target = found->second;
+	}
+}
+
+void mcvm::call(uint32_t function_symbol, const std::vector<uint32_t>& arguments, uint32_t& pc) {
+	if (function_symbol >= defined_functions.size() || defined_functions[function_symbol] < 0) throw std::runtime_error("function " + std::to_string(function_symbol) + " was called before it was defined");
+	uint32_t f = static_cast<uint32_t>(defined_functions[function_symbol]);
+	auto& function = functions[f];
+	if (arguments.size() != function.parameters.size()) throw std::runtime_error("function " + std::to_string(function_symbol) + " takes " + std::to_string(function.parameters.size()) + " arguments, not " + std::to_string(arguments.size()));
+
+	// (the arguments are worked out before the parameters are bound, in case they're the same variables)
+	std::vector<value_ref> values;
+	values.reserve(arguments.size());
+	for (size_t i = 0; i < arguments.size(); i++) {
+		bool by_reference = function.parameters[i].second == value_type::sym;
+		values.push_back(by_reference ? reference_to(arguments[i]) : copy_of(arguments[i]));
+	}
+
+	frames.push_back({ pc + 1, f, saved.size() });
+	for (auto local : function.locals) saved.push_back(std::move(variables[local]));
+	for (size_t i = 0; i < values.size(); i++) variables[function.parameters[i].first] = std::move(values[i]);
+	pc = function.body;
+}
+
+void mcvm::log(uint32_t abi, const std::vector<uint32_t>& arguments) {
+	constexpr const char* prefixes[] = { "[debug] ", "", "[warning] ", "[error] " }; // (logd, logi, logw, loge)
+	if (abi >= std::size(prefixes)) throw std::runtime_error("unknown ABI function " + std::to_string(abi));
+	std::string line = prefixes[abi];
+	for (size_t i = 0; i < arguments.size(); i++) {
+		if (i != 0) line += ' ';
+		line += text(value_of(arguments[i]));
+	}
+	output << line << '\n';
+}
+
+void mcvm::run() {
+	uint32_t pc = 0;
+
+	// each handler does its instruction and moves pc on in a block, then dispatches the next one.
+	// (outside of the block, since jumping out of one with computed goto doesn't destroy what's in it)
+#if MCVM_THREADED_DISPATCH
+#define MCVM_HANDLER_ADDRESS(name) &&op_##name,
+	static void* const handlers[] = { MCVM_OPCODES(MCVM_HANDLER_ADDRESS) };
+#define VM_CASE(name) op_##name:
+#define VM_NEXT() goto *handlers[static_cast<size_t>(code[pc].op)]
+	VM_NEXT();
+#else
+#define VM_CASE(name) case opcode::name:
+#define VM_NEXT() continue
+	for (;;) switch (code[pc].op) {
+#endif
+
+	VM_CASE(dvar) {
+		auto& in = code[pc];
+		auto& v = variables[in.operands[0]];
+		auto o = in.operands[1];
+		if (!(o & constant_operand)) v = reference_to(o);
+		else if (v && v->references == 1 && constants[o & ~constant_operand].elements.empty()) store(*v, value_of(o)); // (nothing else has the old value, so it can be reused)
+		else v = copy_of(o);
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(cvar) {
+		auto& in = code[pc];
+		variables[in.operands[1]] = copy_of(in.operands[0]);
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(jmp) {
+		pc = code[pc].target;
+	}
+	VM_NEXT();
+
+#define MCVM_JUMP(name, T, comparison) \
+	VM_CASE(name) { \
+		auto& in = code[pc]; \
+		T a = number<T>(value_of(in.operands[0])), b = number<T>(value_of(in.operands[1])); \
+		pc = a comparison b ? in.target : pc + 1; \
+	} \
+	VM_NEXT();
+#define MCVM_JUMPS(prefix, T) \
+	MCVM_JUMP(prefix##je, T, ==) MCVM_JUMP(prefix##jne, T, !=) MCVM_JUMP(prefix##jg, T, >) \
+	MCVM_JUMP(prefix##jge, T, >=) MCVM_JUMP(prefix##jl, T, <) MCVM_JUMP(prefix##jle, T, <=)
+
+	MCVM_JUMPS(s, int32_t)
+	MCVM_JUMPS(u, uint32_t)
+	MCVM_JUMPS(f, float)
+	MCVM_JUMPS(d, double)
+
+	VM_CASE(dfunc) {
+		auto& in = code[pc];
+		defined_functions[in.operands[0]] = static_cast<int32_t>(in.target);
+		pc = functions[in.target].end + 1; // (its body runs when it's called)
+	}
+	VM_NEXT();
+	VM_CASE(cfunc) {
+		auto& in = code[pc];
+		uint32_t function_symbol = in.operands[0];
+		if (in.operands[1]) {
+			auto& v = value_of(function_symbol);
+			if (v.type != value_type::sym) throw std::runtime_error("expected a function, got a " + type_name(v.type));
+			function_symbol = static_cast<uint32_t>(v.s);
+		}
+		call(function_symbol, lists[in.target], pc);
+	}
+	VM_NEXT();
+	VM_CASE(endfunc) {
+		if (frames.empty()) return; // (the end of the program)
+		auto returning = frames.back();
+		frames.pop_back();
+		auto& locals = functions[returning.function].locals;
+		for (size_t i = 0; i < locals.size(); i++) variables[locals[i]] = std::move(saved[returning.saved + i]);
+		saved.resize(returning.saved);
+		pc = returning.return_to;
+	}
+	VM_NEXT();
+	VM_CASE(cabi) {
+		auto& in = code[pc];
+		log(in.operands[0], lists[in.target]);
+		pc++;
+	}
+	VM_NEXT();
+
+	VM_CASE(garrl) {
+		auto& in = code[pc];
+		auto length = static_cast<uint32_t>(array(in.operands[0]).size());
+		store(result(in.operands[1]), length);
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(garr) {
+		auto& in = code[pc];
+		auto& elements = array(in.operands[0]);
+		auto element = elements[index(elements, in.operands[1])]; // (kept hold of, in case the result is the array)
+		store(result(in.operands[2]), *element);
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(sarr) {
+		auto& in = code[pc];
+		auto& elements = array(in.operands[0]);
+		auto i = index(elements, in.operands[1]);
+		elements[i] = reference_to(in.operands[2]);
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(aarr) {
+		auto& in = code[pc];
+		auto value = reference_to(in.operands[1]);
+		array(in.operands[0]).push_back(std::move(value));
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(iarr) {
+		auto& in = code[pc];
+		auto& elements = array(in.operands[0]);
+		auto i = index(elements, in.operands[1], true);
+		elements.insert(elements.begin() + i, reference_to(in.operands[2]));
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(rarr) {
+		auto& in = code[pc];
+		auto& elements = array(in.operands[0]);
+		elements.erase(elements.begin() + index(elements, in.operands[1]));
+		pc++;
+	}
+	VM_NEXT();
+
+#define MCVM_CONVERSION(name, T, converted) \
+	VM_CASE(name) { \
+		auto& in = code[pc]; \
+		T v = number<T>(value_of(in.operands[0])); \
+		store(result(in.operands[1]), converted); \
+		pc++; \
+	} \
+	VM_NEXT();
+
+	MCVM_CONVERSION(s2u, int32_t, static_cast<uint32_t>(v))
+	MCVM_CONVERSION(s2f, int32_t, static_cast<float>(v))
+	MCVM_CONVERSION(s2d, int32_t, static_cast<double>(v))
+	MCVM_CONVERSION(s2str, int32_t, number_text(v))
+	MCVM_CONVERSION(u2s, uint32_t, static_cast<int32_t>(v))
+	MCVM_CONVERSION(u2f, uint32_t, static_cast<float>(v))
+	MCVM_CONVERSION(u2d, uint32_t, static_cast<double>(v))
+	MCVM_CONVERSION(u2str, uint32_t, number_text(v))
+	MCVM_CONVERSION(f2s, float, to_integer<int32_t>(v))
+	MCVM_CONVERSION(f2u, float, to_integer<uint32_t>(v))
+	MCVM_CONVERSION(f2d, float, static_cast<double>(v))
+	MCVM_CONVERSION(f2str, float, number_text(v))
+	MCVM_CONVERSION(d2s, double, to_integer<int32_t>(v))
+	MCVM_CONVERSION(d2u, double, to_integer<uint32_t>(v))
+	MCVM_CONVERSION(d2f, double, static_cast<float>(v))
+	MCVM_CONVERSION(d2str, double, number_text(v))
+
+	VM_CASE(s2sym) {
+		auto& in = code[pc];
+		store(result(in.operands[1]), number<int32_t>(value_of(in.operands[0])), value_type::sym);
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(u2sym) {
+		auto& in = code[pc];
+		store(result(in.operands[1]), static_cast<int32_t>(number<uint32_t>(value_of(in.operands[0]))), value_type::sym);
+		pc++;
+	}
+	VM_NEXT();
+	// (a variable's symbol, rather than its value)
+	VM_CASE(sym2s) {
+		auto& in = code[pc];
+		store(result(in.operands[1]), static_cast<int32_t>(in.operands[0]));
+		pc++;
+	}
+	VM_NEXT();
+	VM_CASE(sym2u) {
+		auto& in = code[pc];
+		store(result(in.operands[1]), in.operands[0]);
+		pc++;
+	}
+	VM_NEXT();
+
+	// (ints wrap around)
+#define MCVM_ARITHMETIC(name, T, expression) \
+	VM_CASE(name) { \
+		auto& in = code[pc]; \
+		T a = number<T>(value_of(in.operands[0])), b = number<T>(value_of(in.operands[1])); \
+		store(result(in.operands[2]), static_cast<T>(expression)); \
+		pc++; \
+	} \
+	VM_NEXT();
+#define MCVM_DIVISION(name, T, quotient, remainder) \
+	VM_CASE(name) { \
+		auto& in = code[pc]; \
+		T a = number<T>(value_of(in.operands[0])), b = number<T>(value_of(in.operands[1])); \
+		if constexpr (std::is_integral_v<T>) { \
+			if (b == 0) throw std::runtime_error("division by 0"); \
+		} \
+		store(result(in.operands[2]), static_cast<T>(quotient)); \
+		store(result(in.operands[3]), static_cast<T>(remainder)); \
+		pc++; \
+	} \
+	VM_NEXT();
+
+	MCVM_ARITHMETIC(sadd, int32_t, uint32_t(a) + uint32_t(b))
+	MCVM_ARITHMETIC(ssub, int32_t, uint32_t(a) - uint32_t(b))
+	MCVM_ARITHMETIC(smul, int32_t, uint32_t(a) * uint32_t(b))
+	MCVM_DIVISION(sdiv, int32_t, b == -1 ? 0u - uint32_t(a) : a / b, b == -1 ? 0 : a % b) // (INT32_MIN / -1 wraps around too)
+	MCVM_ARITHMETIC(uadd, uint32_t, a + b)
+	MCVM_ARITHMETIC(usub, uint32_t, a - b)
+	MCVM_ARITHMETIC(umul, uint32_t, a * b)
+	MCVM_DIVISION(udiv, uint32_t, a / b, a % b)
+	MCVM_ARITHMETIC(fadd, float, a + b)
+	MCVM_ARITHMETIC(fsub, float, a - b)
+	MCVM_ARITHMETIC(fmul, float, a * b)
+	MCVM_DIVISION(fdiv, float, a / b, std::fmod(a, b))
+	MCVM_ARITHMETIC(dadd, double, a + b)
+	MCVM_ARITHMETIC(dsub, double, a - b)
+	MCVM_ARITHMETIC(dmul, double, a * b)
+	MCVM_DIVISION(ddiv, double, a / b, std::fmod(a, b))
+
+	VM_CASE(label) {
+		assert(false); // (labels aren't instructions, they're never in the bytecode)
+		return;
+	}
+
+#if !MCVM_THREADED_DISPATCH
+	}
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+}
+
+void run_bytecode(const std::vector<uint8_t>& bytecode, std::ostream& output) {
+	mcvm vm(bytecode, output);
+	vm.run();
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// an interpreter for MCVM bytecode (what assemble() makes), so the compiler's output can be run and timed locally.
+// the bytecode is decoded into instructions up front, with operands already resolved to variables or constants and jumps to instruction indices, and those are dispatched with computed goto (or a switch where that isn't supported, like MSVC).
+// cabi's log functions print to the given stream (stdout unless told otherwise).
+// variables are bound to values like in mcasm/program5.mcasm: dvar and cvar bind a variable to a value (dvar x sym:y to y's), everything else writes into the value it's bound to.
+
+// throws std::runtime_error if the bytecode is invalid, or if the program does something it can't (like dividing by 0)
+void run_bytecode(const std::vector<uint8_t>& bytecode, std::ostream& output = std::cout);
@@ -0,0 +1,949 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <unordered_map>
+
+// what an instruction does with one of its operands
+enum class operand_role : uint8_t {
+	none,
+	value, // reads a value (sym: or an immediate)
+	kept, // reads a value and might keep referring to it afterwards, like "dvar x sym:y" does (so y can change through x)
+	address, // looks at which variable it is, not at its value (sym2s)
+	read, // reads a variable, by name
+	write, // (re)defines a variable, by name
+	modify, // changes a variable in place, by name (arrays)
+	label,
+	value_list, // cabi's arguments, values
+	kept_list, // cfunc's arguments, kept values (the parameter could be a reference)
+	parameters, // dfunc's, which defines them
+	parameter, // an element of parameters
+	other, // a function or ABI function name
+};
+
+static std::array<operand_role, 4> operand_roles(opcode op) {
+	using r = operand_role;
+	switch (op) {
+	case opcode::dvar: return { r::write, r::kept };
+	case opcode::cvar: return { r::read, r::write }; // "cvar from to"
+	case opcode::jmp: case opcode::label: return { r::label };
+	case opcode::dfunc: return { r::other, r::parameters };
+	case opcode::cfunc: return { r::read, r::kept_list };
+	case opcode::cabi: return { r::other, r::value_list };
+	case opcode::garrl: return { r::read, r::write };
+	case opcode::garr: return { r::read, r::value, r::write };
+	case opcode::sarr: case opcode::iarr: return { r::modify, r::value, r::kept };
+	case opcode::aarr: return { r::modify, r::kept };
+	case opcode::rarr: return { r::modify, r::value };
+	case opcode::sym2s: case opcode::sym2u: return { r::address, r::write };
+	case opcode::endfunc: return {};
+	default:
+		if (is_conditional_jump(op)) return { r::label, r::value, r::value };
+		if (is_conversion(op)) return { r::value, r::write };
+		assert(is_arithmetic(op));
+		return { r::value, r::value, r::write, r::write }; // (the 4th is division's remainder)
+	}
+}
+
+static bool reads(operand_role role) {
+	return role == operand_role::value || role == operand_role::kept || role == operand_role::address || role == operand_role::read || role == operand_role::modify;
+}
+
+static bool writes(operand_role role) {
+	return role == operand_role::write || role == operand_role::modify || role == operand_role::parameter;
+}
+
+static bool names_variable(const mcasm_operand& o) {
+	return o.kind == mcasm_operand::kind_t::name || o.kind == mcasm_operand::kind_t::symbol;
+}
+
+// calls f(operand, role) for each of the instruction's operands that's a variable, including the ones in parameter and argument lists
+template <typename F>
+static void for_each_variable_operand(mcasm_program& program, instruction& i, F&& f) {
+	auto roles = operand_roles(i.op);
+	for (size_t j = 0; j < i.operand_count; j++) {
+		auto& o = i.operands[j];
+		switch (roles[j]) {
+		case operand_role::value_list:
+		case operand_role::kept_list:
+		case operand_role::parameters: {
+			auto element_role = roles[j] == operand_role::value_list ? operand_role::value : roles[j] == operand_role::kept_list ? operand_role::kept : operand_role::parameter;
+			for (auto& element : program.lists[o.index]) {
+				if (names_variable(element)) f(element, element_role);
+			}
+			break;
+		}
+		case operand_role::none:
+		case operand_role::label:
+		case operand_role::other:
+			break;
+		default:
+			if (names_variable(o)) f(o, roles[j]);
+			break;
+		}
+	}
+}
+
+// instructions that code can't be moved across, or assumed to run straight through: control flow, and calls, which can read and write any variable they can see.
+static bool is_barrier(opcode op) {
+	return op == opcode::label || op == opcode::jmp || is_conditional_jump(op) || op == opcode::cfunc || op == opcode::dfunc || op == opcode::endfunc;
+}
+
+// instructions that do nothing but write their result, so they can go if nothing reads it.
+// (not division, which can fail)
+static bool is_pure(opcode op) {
+	if (op == opcode::sdiv || op == opcode::udiv || op == opcode::fdiv || op == opcode::ddiv) return false;
+	return op == opcode::dvar || op == opcode::cvar || op == opcode::garrl || op == opcode::garr || is_conversion(op) || is_arithmetic(op);
+}
+
+struct variable_use {
+	uint32_t instruction;
+	operand_role role;
+};
+
+// what the passes need to know about the program as it is. every pass makes a new one, since they change it.
+class program_analysis {
+public:
+	explicit program_analysis(mcasm_program& program) {
+		auto& code = program.code;
+		uses.resize(interner.size());
+		region.resize(code.size());
+		barriers.resize(code.size() + 1);
+		calls.resize(code.size() + 1);
+		parent_region.push_back(0);
+
+		uint32_t current = 0;
+		for (uint32_t i = 0; i < code.size(); i++) {
+			auto& instr = code[i];
+			if (instr.op == opcode::dfunc) { // (the dfunc is part of the function, it defines the parameters)
+				parent_region.push_back(current);
+				current = static_cast<uint32_t>(parent_region.size() - 1);
+			}
+			region[i] = current;
+			if (instr.op == opcode::endfunc) current = parent_region[current];
+
+			barriers[i + 1] = barriers[i] + is_barrier(instr.op);
+			calls[i + 1] = calls[i] + (instr.op == opcode::cfunc);
+
+			if (instr.op == opcode::label) labels[instr[0].name] = i;
+			else if (instr.op == opcode::jmp || is_conditional_jump(instr.op)) jumps[instr[0].name].push_back(i);
+
+			for_each_variable_operand(program, instr, [&](mcasm_operand& o, operand_role role) {
+				uses[o.name].push_back(variable_use{ .instruction = i, .role = role });
+			});
+		}
+	}
+
+	std::vector<std::vector<variable_use>> uses; // of each variable, indexed by symbol ID, in program order
+	std::vector<uint32_t> region; // of each instruction. 0 is the top level, and each function body is its own region
+	std::vector<uint32_t> parent_region;
+	std::vector<uint32_t> barriers; // barriers[i] is how many barriers there are before instruction i
+	std::vector<uint32_t> calls; // same for cfunc
+	std::unordered_map<symbol_id, uint32_t> labels; // where each label is
+	std::unordered_map<symbol_id, std::vector<uint32_t>> jumps; // to each label
+
+	// whether there are no barriers between the two instructions (not counting them)
+	bool straight(uint32_t from, uint32_t to) const {
+		return from >= to || barriers[to] - barriers[from + 1] == 0;
+	}
+
+	// same, except for calls
+	bool straight_but_for_calls(uint32_t from, uint32_t to) const {
+		return from >= to || barriers[to] - barriers[from + 1] == calls[to] - calls[from + 1];
+	}
+
+	bool encloses(uint32_t outer, uint32_t inner) const {
+		while (inner != outer && inner != 0) inner = parent_region[inner];
+		return inner == outer;
+	}
+
+	// whether code between the two instructions (not counting them) can only be entered at the top, doesn't call anything, and only jumps within itself
+	bool self_contained(const mcasm_program& program, uint32_t from, uint32_t to) const {
+		for (uint32_t i = from + 1; i < to; i++) {
+			auto& instr = program.code[i];
+			if (instr.op == opcode::cfunc || instr.op == opcode::dfunc || instr.op == opcode::endfunc) return false;
+			if (instr.op == opcode::label) {
+				auto found = jumps.find(instr[0].name);
+				if (found == jumps.end()) continue;
+				for (auto jump : found->second) {
+					if (jump <= from || jump >= to) return false;
+				}
+			}
+			else if (instr.op == opcode::jmp || is_conditional_jump(instr.op)) {
+				auto target = labels.at(instr[0].name);
+				if (target <= from || target >= to) return false;
+			}
+		}
+		return true;
+	}
+
+	bool is_parameter(symbol_id v) const {
+		for (auto& u : uses[v]) if (u.role == operand_role::parameter) return true;
+		return false;
+	}
+
+	// whether "dvar v sym:..." ever makes v another name for something (other than at the given instruction)
+	bool is_alias(const mcasm_program& program, symbol_id v, uint32_t except = UINT32_MAX) const {
+		for (auto& u : uses[v]) {
+			auto& instr = program.code[u.instruction];
+			if (u.instruction == except) continue;
+			if (u.role == operand_role::write && instr.op == opcode::dvar && instr[1].kind == mcasm_operand::kind_t::symbol) return true;
+		}
+		return false;
+	}
+
+	// whether v's value is only ever reachable through v, so writing into it can't change anything else (not counting the given instruction)
+	bool is_unshared(const mcasm_program& program, symbol_id v, uint32_t except = UINT32_MAX) const {
+		if (is_parameter(v) || is_alias(program, v, except)) return false;
+		for (auto& u : uses[v]) {
+			if (u.role == operand_role::kept || u.role == operand_role::address) return false;
+		}
+		return true;
+	}
+};
+
+// one pass's changes. instructions are only removed at the end, and once a pass has changed part of the program it leaves that part alone (its analysis is out of date there)
+struct program_edit {
+	explicit program_edit(const mcasm_program& program) : removed(program.code.size()), touched(program.code.size()) {}
+
+	std::vector<bool> removed;
+	std::vector<bool> touched;
+	bool changed = false;
+
+	bool is_touched(uint32_t from, uint32_t to) const {
+		for (uint32_t i = from; i <= to; i++) if (touched[i]) return true;
+		return false;
+	}
+
+	void touch(uint32_t from, uint32_t to) {
+		for (uint32_t i = from; i <= to; i++) touched[i] = true;
+		changed = true;
+	}
+
+	void apply(mcasm_program& program) const {
+		size_t kept = 0;
+		for (size_t i = 0; i < program.code.size(); i++) {
+			if (!removed[i]) program.code[kept++] = program.code[i];
+		}
+		program.code.resize(kept);
+	}
+};
+
+static void rename(mcasm_program& program, uint32_t from, uint32_t to, symbol_id old_name, symbol_id new_name) {
+	for (uint32_t i = from; i < to; i++) {
+		for_each_variable_operand(program, program.code[i], [&](mcasm_operand& o, operand_role) {
+			if (o.name == old_name) o.name = new_name;
+		});
+	}
+}
+
+struct function_definition {
+	uint32_t start, end; // its dfunc and endfunc
+};
+
+// every function's definition, by name
+static std::unordered_map<symbol_id, function_definition> find_functions(const mcasm_program& program) {
+	std::unordered_map<symbol_id, function_definition> functions;
+	std::vector<uint32_t> unfinished;
+	for (uint32_t i = 0; i < program.code.size(); i++) {
+		if (program.code[i].op == opcode::dfunc) unfinished.push_back(i);
+		else if (program.code[i].op == opcode::endfunc) {
+			functions[program.code[unfinished.back()][0].name] = function_definition{ .start = unfinished.back(), .end = i };
+			unfinished.pop_back();
+		}
+	}
+	return functions;
+}
+
+// the function a cfunc calls, if it can tell: either the function itself, or a variable that's only ever that function.
+// no_symbol if it can't.
+static symbol_id find_callee(const mcasm_program& program, const program_analysis& a, const std::unordered_map<symbol_id, function_definition>& functions, symbol_id called) {
+	if (functions.contains(called)) return called;
+
+	auto& uses = a.uses[called];
+	if (uses.empty()) return no_symbol;
+	auto& definition = program.code[uses.front().instruction];
+	if (definition.op != opcode::dvar || definition[0].name != called || definition[1].kind != mcasm_operand::kind_t::symbol || !functions.contains(definition[1].name)) return no_symbol;
+	for (size_t k = 1; k < uses.size(); k++) {
+		if (writes(uses[k].role)) return no_symbol;
+	}
+	return definition[1].name;
+}
+
+// which variables might be names for the same value, or for values stored in each other (arrays).
+// anything that keeps referring to a value joins the variables together: "dvar x sym:y", storing in an array, getting from an array, and passing arguments to parameters.
+class alias_classes {
+public:
+	alias_classes(mcasm_program& program, const program_analysis& a, const std::unordered_map<symbol_id, function_definition>& functions) : parent(interner.size() + 1) {
+		for (uint32_t v = 0; v < parent.size(); v++) parent[v] = v;
+
+		bool unknown_calls = false;
+		for (auto& instr : program.code) {
+			switch (instr.op) {
+			case opcode::dvar:
+				if (instr[1].kind == mcasm_operand::kind_t::symbol) join(instr[0].name, instr[1].name);
+				break;
+			case opcode::aarr:
+			case opcode::sarr:
+			case opcode::iarr: {
+				auto& value = instr[instr.op == opcode::aarr ? 1 : 2];
+				if (names_variable(value)) join(instr[0].name, value.name);
+				break;
+			}
+			case opcode::garr:
+				join(instr[0].name, instr[2].name);
+				break;
+			case opcode::cfunc: {
+				auto callee = find_callee(program, a, functions, instr[0].name);
+				auto& arguments = program.lists[instr[1].index];
+				if (callee == no_symbol) {
+					// (then its parameters could be any of the arguments passed to anything)
+					unknown_calls = true;
+					for (auto& argument : arguments) if (names_variable(argument)) join(argument.name, unknown);
+					break;
+				}
+				auto& parameters = program.lists[program.code[functions.at(callee).start][1].index];
+				for (size_t k = 0; k < arguments.size() && k < parameters.size(); k++) {
+					if (names_variable(arguments[k])) join(arguments[k].name, parameters[k].name);
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+		if (unknown_calls) {
+			for (auto& [name, definition] : functions) {
+				for (auto& parameter : program.lists[program.code[definition.start][1].index]) join(parameter.name, unknown);
+			}
+		}
+
+		for (symbol_id v = 0; v < a.uses.size(); v++) {
+			if (!a.uses[v].empty()) members[find(v)].push_back(v);
+		}
+	}
+
+	uint32_t find(uint32_t v) {
+		while (parent[v] != v) v = parent[v] = parent[parent[v]];
+		return v;
+	}
+
+	// the variables that might share a value with v, v included
+	const std::vector<symbol_id>& aliases(symbol_id v) { return members[find(v)]; }
+
+	// whether v might share a value with something that's not known
+	bool unknown_aliases(symbol_id v) { return find(v) == find(unknown); }
+
+private:
+	std::vector<uint32_t> parent;
+	std::unordered_map<uint32_t, std::vector<symbol_id>> members;
+	const uint32_t unknown = static_cast<uint32_t>(interner.size()); // stands for the parameters of functions that are called without knowing which
+
+	void join(uint32_t v, uint32_t w) { parent[find(v)] = find(w); }
+};
+
+// a variable that's declared with dvar and then declared again before anything looks at it doesn't need the first declaration.
+// (codegen does this for comparisons, whose result is declared by both the operation and the comparison)
+static void remove_redeclarations(mcasm_program& program, const program_analysis& a, program_edit& edit) {
+	for (auto& u : a.uses) {
+		if (u.size() < 2) continue;
+		uint32_t first = u[0].instruction, next = u[1].instruction;
+		auto& declaration = program.code[first];
+		auto& redeclaration = program.code[next];
+		// (the first use has to be the declaration, otherwise the variable could already be another name for something, which dvar might write to)
+		if (declaration.op != opcode::dvar || u[0].role != operand_role::write || first == next) continue;
+		// (a cvar into it declares it again too)
+		if ((redeclaration.op != opcode::dvar && redeclaration.op != opcode::cvar) || u[1].role != operand_role::write || (u.size() > 2 && u[2].instruction == next)) continue;
+		if (!a.straight(first, next) || edit.is_touched(first, next)) continue;
+
+		edit.removed[first] = true;
+		if (redeclaration.comment == no_symbol) redeclaration.comment = declaration.comment;
+		edit.touch(first, next);
+	}
+}
+
+// a temporary that's only there to be moved into another variable (with "dvar x sym:t" or "cvar t x") can be that variable instead.
+// also gets rid of the temporary's "dvar t sint:0" pre-declaration if the variable already exists.
+static void forward_results(mcasm_program& program, const program_analysis& a, program_edit& edit) {
+	for (uint32_t d = 0; d < program.code.size(); d++) {
+		auto& move = program.code[d];
+		symbol_id t, x;
+		if (move.op == opcode::dvar && move[1].kind == mcasm_operand::kind_t::symbol) {
+			x = move[0].name;
+			t = move[1].name;
+		}
+		else if (move.op == opcode::cvar) {
+			t = move[0].name;
+			x = move[1].name;
+		}
+		else continue;
+		if (x == t) continue;
+
+		// t has to be a temporary: declared, used, and moved into x, all in one piece of code with nothing else going on
+		auto& ut = a.uses[t];
+		uint32_t first = ut.front().instruction;
+		if (ut.back().instruction != d || first == d) continue;
+		auto& declaration = program.code[first];
+		if (declaration.op != opcode::dvar || declaration[0].name != t || a.region[first] != a.region[d]) continue;
+		if (!a.self_contained(program, first, d) || edit.is_touched(first, d)) continue;
+		if (move.op == opcode::cvar) {
+			// x has to end up with a value of its own, which t's isn't if t is ever made another name for something, or something is made another name for t
+			bool fresh = !a.is_alias(program, t);
+			for (auto& u : ut) fresh &= u.role != operand_role::kept;
+			if (!fresh) continue;
+		}
+
+		bool x_used = false;
+		for (auto& u : a.uses[x]) x_used |= u.instruction >= first && u.instruction < d;
+
+		if (!x_used) {
+			// then x can just be declared where t is
+			rename(program, first, d, t, x);
+			if (declaration.comment == no_symbol) declaration.comment = move.comment;
+		}
+		else {
+			// x is read while t is being worked out. that's fine as long as it already exists, t's pre-declaration (which would overwrite it too early) can go, and x isn't read after t's first real write
+			auto& ux = a.uses[x];
+			uint32_t x_declaration = ux.front().instruction;
+			if (x_declaration >= first || !a.encloses(a.region[x_declaration], a.region[d])) continue;
+			if (!a.is_unshared(program, x, d)) continue; // (writing into x would change whatever else refers to its value, while moving into x wouldn't have)
+
+			if (ut.size() < 3) continue;
+			uint32_t write = ut[1].instruction;
+			if (ut[1].role != operand_role::write || ut[2].instruction == write || !a.straight(first, write)) continue; // (the pre-declared value can't be read)
+
+			bool ok = true;
+			for (auto& u : ux) {
+				if (u.instruction >= first && u.instruction < d && (writes(u.role) || u.instruction > write)) ok = false;
+			}
+			if (!ok) continue;
+
+			edit.removed[first] = true;
+			rename(program, first + 1, d, t, x);
+			if (program.code[write].comment == no_symbol) program.code[write].comment = move.comment;
+		}
+		edit.removed[d] = true;
+		edit.touch(first, d);
+	}
+}
+
+// a variable that's only ever given one value (an immediate or another variable's) is replaced by that value where it's read, if that's the same thing.
+static void propagate_copies(mcasm_program& program, const program_analysis& a, program_edit& edit) {
+	alias_classes aliases(program, a, find_functions(program));
+	bool any_symbol = false; // (a symbol made from a number could be any variable, so then a copy's source could be changed through anything)
+	for (auto& instr : program.code) any_symbol |= instr.op == opcode::s2sym || instr.op == opcode::u2sym;
+
+	for (symbol_id t = 0; t < a.uses.size(); t++) {
+		auto& ut = a.uses[t];
+		if (ut.size() < 2 || ut[0].role != operand_role::write || ut[1].instruction == ut[0].instruction) continue;
+		uint32_t d = ut[0].instruction, last = ut.back().instruction;
+		auto& definition = program.code[d];
+
+		enum { alias, copy, immediate } kind;
+		mcasm_operand source;
+		if (definition.op == opcode::dvar && definition[1].kind == mcasm_operand::kind_t::symbol) {
+			kind = alias;
+			source = definition[1];
+		}
+		else if (definition.op == opcode::dvar && definition[1].is_immediate()) {
+			kind = immediate;
+			source = definition[1];
+		}
+		else if (definition.op == opcode::cvar) {
+			kind = copy;
+			source = mcasm_operand::value_of(definition[0].name);
+		}
+		else continue;
+		if (kind != immediate && source.name == t) continue;
+
+		if (a.region[d] != a.region[last] || !a.straight_but_for_calls(d, last) || edit.is_touched(d, last)) continue;
+		bool across_calls = !a.straight(d, last); // (the functions called can't change t without naming it, but they could change the source)
+
+		bool ok = true;
+		for (size_t k = 1; k < ut.size(); k++) {
+			auto role = ut[k].role;
+			if (writes(role)) ok = false;
+			else if (kind == alias) ok &= role != operand_role::address; // (t is the same value as the source, but not the same variable)
+			else if (kind == copy) ok &= role == operand_role::value || role == operand_role::read; // (anything that keeps referring to t would start referring to the source instead)
+			else ok &= role == operand_role::value || (role == operand_role::kept && ut[k].instruction == last); // (needs a value, and if it keeps referring to t, nothing else can be using t afterwards)
+		}
+		if (kind == alias) {
+			// the source can't be made something else while t's still used (changing its value changes t's too)
+			for (auto& u : a.uses[source.name]) {
+				if (writes(u.role) && (across_calls || (u.instruction > d && u.instruction < last))) ok = false;
+			}
+		}
+		else if (kind == copy) {
+			// the source's value can't change while t's still used, including through anything that might be another name for it
+			if (any_symbol || (across_calls && aliases.unknown_aliases(source.name))) ok = false;
+			for (auto v : aliases.aliases(source.name)) {
+				for (auto& u : a.uses[v]) {
+					if (writes(u.role) && (across_calls || (u.instruction > d && u.instruction < last))) ok = false;
+				}
+			}
+		}
+		if (!ok) continue;
+
+		for (size_t k = 1; k < ut.size(); k++) {
+			if (ut[k].instruction == ut[k - 1].instruction) continue;
+			for_each_variable_operand(program, program.code[ut[k].instruction], [&](mcasm_operand& o, operand_role) {
+				if (o.name != t) return;
+				if (kind == immediate) o = source;
+				else o.name = source.name;
+			});
+		}
+		edit.removed[d] = true;
+		edit.touch(d, last);
+	}
+}
+
+// removes the instructions that write to a variable nothing else ever reads
+static void remove_dead_stores(mcasm_program& program, const program_analysis& a, program_edit& edit) {
+	for (symbol_id t = 0; t < a.uses.size(); t++) {
+		auto& ut = a.uses[t];
+		if (ut.empty()) continue;
+
+		bool removable = true;
+		bool alias = a.is_alias(program, t);
+		for (auto& u : ut) {
+			auto& instr = program.code[u.instruction];
+			if (u.role == operand_role::parameter || !is_pure(instr.op)) removable = false;
+			if (reads(u.role)) {
+				// (reading t to work out t's new value doesn't count, like "s2d sym:t t")
+				bool updates_itself = false;
+				for (auto& other : ut) updates_itself |= other.instruction == u.instruction && other.role == operand_role::write;
+				if (!updates_itself) removable = false;
+			}
+			// (if t's another name for something, writing into it isn't dead, only making it another name is)
+			if (alias && !(instr.op == opcode::dvar && instr[1].kind == mcasm_operand::kind_t::symbol)) removable = false;
+		}
+		for (auto& u : ut) removable &= !edit.touched[u.instruction]; // (all or nothing, or what's left might not be declared)
+		if (!removable) continue;
+
+		for (auto& u : ut) {
+			edit.removed[u.instruction] = true;
+			edit.touch(u.instruction, u.instruction);
+		}
+	}
+}
+
+// removes jumps to right where they'd go anyway, labels nothing jumps to, and code that can't be reached after a jmp
+static void remove_useless_jumps(mcasm_program& program, const program_analysis& a, program_edit& edit) {
+	for (uint32_t i = 0; i < program.code.size(); i++) {
+		auto& instr = program.code[i];
+		if (instr.op == opcode::label && !a.jumps.contains(instr[0].name)) {
+			edit.removed[i] = true;
+			edit.touch(i, i);
+			continue;
+		}
+		if (instr.op == opcode::jmp) {
+			for (uint32_t j = i + 1; j < program.code.size(); j++) {
+				auto op = program.code[j].op;
+				if (op == opcode::label || op == opcode::dfunc || op == opcode::endfunc) break;
+
+				// (the first dvar of a variable still declares it for the code after it, as far as the assembler is concerned)
+				bool declares = false;
+				for_each_variable_operand(program, program.code[j], [&](mcasm_operand& o, operand_role) {
+					declares |= a.uses[o.name].front().instruction == j && a.uses[o.name].back().instruction > j;
+				});
+				if (declares || edit.touched[j]) continue;
+				edit.removed[j] = true;
+				edit.touch(j, j);
+			}
+		}
+		if (instr.op != opcode::jmp && !is_conditional_jump(instr.op)) continue;
+		uint32_t target = a.labels.at(instr[0].name);
+		if (target <= i) continue;
+
+		bool useless = true;
+		for (uint32_t j = i + 1; j < target; j++) useless &= program.code[j].op == opcode::label;
+		if (!useless || edit.touched[i]) continue;
+
+		edit.removed[i] = true;
+		edit.touch(i, i);
+	}
+}
+
+// removes functions nothing calls or refers to
+static void remove_unused_functions(mcasm_program& program, const program_analysis& a, program_edit& edit) {
+	for (auto& [name, definition] : find_functions(program)) {
+		if (!a.uses[name].empty() || edit.is_touched(definition.start, definition.end)) continue;
+		for (uint32_t i = definition.start; i <= definition.end; i++) edit.removed[i] = true;
+		edit.touch(definition.start, definition.end);
+	}
+}
+
+void eliminate_redundant_code(mcasm_program& program) {
+	using pass = void(*)(mcasm_program&, const program_analysis&, program_edit&);
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (pass p : { remove_redeclarations, forward_results, propagate_copies, remove_dead_stores, remove_useless_jumps, remove_unused_functions }) {
+			program_analysis analysis(program);
+			program_edit edit(program);
+			p(program, analysis, edit);
+			edit.apply(program);
+			changed |= edit.changed;
+		}
+	}
+}
+
+// a set of a region's variables, by their index in it
+class variable_set {
+public:
+	explicit variable_set(size_t size = 0) : words((size + 63) / 64) {}
+
+	bool contains(size_t v) const { return words[v / 64] >> (v % 64) & 1; }
+	void insert(size_t v) { words[v / 64] |= uint64_t(1) << (v % 64); }
+
+	// returns whether it changed
+	bool insert_all(const variable_set& other) {
+		bool changed = false;
+		for (size_t i = 0; i < words.size(); i++) {
+			changed |= (other.words[i] & ~words[i]) != 0;
+			words[i] |= other.words[i];
+		}
+		return changed;
+	}
+
+	template <typename F>
+	void for_each(F&& f) const {
+		for (size_t i = 0; i < words.size(); i++) {
+			for (uint64_t w = words[i]; w != 0; w &= w - 1) f(i * 64 + std::countr_zero(w));
+		}
+	}
+
+private:
+	std::vector<uint64_t> words;
+};
+
+// dvar and cvar bind a variable to another value, leaving the one it had alone. everything else that writes to a variable writes into the value it already has, so that has to still be its own.
+static bool rebinds(const instruction& instr, const mcasm_operand& o) {
+	return (instr.op == opcode::dvar && &o == &instr[0]) || (instr.op == opcode::cvar && &o == &instr[1]);
+}
+
+static void reuse_dead_variables(mcasm_program& program, const program_analysis& a, uint32_t region) {
+	auto& code = program.code;
+
+	std::vector<uint32_t> instructions; // the region's own, in order
+	for (uint32_t i = 0; i < code.size(); i++) {
+		if (a.region[i] == region) instructions.push_back(i);
+	}
+	if (instructions.empty()) return;
+	std::unordered_map<uint32_t, uint32_t> position; // in instructions, of each of them
+	for (uint32_t p = 0; p < instructions.size(); p++) position[instructions[p]] = p;
+
+	// the variables that only this region uses, and that start out by being bound to something (parameters are bound by the caller)
+	std::vector<symbol_id> variables;
+	std::unordered_map<symbol_id, uint32_t> variable_index;
+	for (auto i : instructions) {
+		for_each_variable_operand(program, code[i], [&](mcasm_operand& o, operand_role) {
+			symbol_id v = o.name;
+			if (variable_index.contains(v)) return;
+			auto& uses = a.uses[v];
+			if (uses.front().instruction != i || !writes(uses.front().role) || uses.front().role == operand_role::parameter) return;
+			for (auto& u : uses) {
+				if (a.region[u.instruction] != region) return;
+			}
+			variable_index[v] = static_cast<uint32_t>(variables.size());
+			variables.push_back(v);
+		});
+	}
+	if (variables.empty()) return;
+
+	// what each instruction needs (reads, or writes into) and what it binds
+	std::vector<variable_set> needs(instructions.size(), variable_set(variables.size())), binds = needs;
+	for (uint32_t p = 0; p < instructions.size(); p++) {
+		auto& instr = code[instructions[p]];
+		std::vector<uint32_t> bound;
+		for_each_variable_operand(program, instr, [&](mcasm_operand& o, operand_role) {
+			auto found = variable_index.find(o.name);
+			if (found == variable_index.end()) return;
+			if (rebinds(instr, o)) bound.push_back(found->second);
+			else needs[p].insert(found->second);
+		});
+		for (auto v : bound) {
+			if (!needs[p].contains(v)) binds[p].insert(v);
+		}
+	}
+
+	// where each instruction can go next
+	std::vector<std::vector<uint32_t>> successors(instructions.size());
+	for (uint32_t p = 0; p < instructions.size(); p++) {
+		auto& instr = code[instructions[p]];
+		if (instr.op == opcode::endfunc) continue;
+		if (instr.op == opcode::jmp || is_conditional_jump(instr.op)) successors[p].push_back(position.at(a.labels.at(instr[0].name)));
+		if (instr.op != opcode::jmp && p + 1 < instructions.size()) successors[p].push_back(p + 1);
+	}
+
+	// which variables are alive (still needed) right after each instruction, worked out backwards until nothing changes
+	std::vector<variable_set> live_out(instructions.size(), variable_set(variables.size()));
+	auto live_in = [&](uint32_t p) {
+		variable_set in(variables.size());
+		live_out[p].for_each([&](size_t v) { if (!binds[p].contains(v)) in.insert(v); });
+		in.insert_all(needs[p]);
+		return in;
+	};
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (uint32_t p = static_cast<uint32_t>(instructions.size()); p-- > 0;) {
+			for (auto s : successors[p]) changed |= live_out[p].insert_all(live_in(s));
+		}
+	}
+
+	// two variables can't share a name if one's bound or written while the other's alive, or if they're both used by the same instruction
+	std::vector<variable_set> interferes(variables.size(), variable_set(variables.size()));
+	auto interfere = [&](size_t v, size_t w) {
+		if (v == w) return;
+		interferes[v].insert(w);
+		interferes[w].insert(v);
+	};
+	for (uint32_t p = 0; p < instructions.size(); p++) {
+		variable_set here = needs[p];
+		here.insert_all(binds[p]);
+		here.for_each([&](size_t v) {
+			live_out[p].for_each([&](size_t w) { interfere(v, w); });
+			here.for_each([&](size_t w) { interfere(v, w); });
+		});
+	}
+
+	// then name each one after the first variable it doesn't interfere with, in order
+	std::vector<uint32_t> slot(variables.size());
+	std::vector<symbol_id> slot_names;
+	for (uint32_t v = 0; v < variables.size(); v++) {
+		std::vector<bool> taken(slot_names.size());
+		interferes[v].for_each([&](size_t w) { if (w < v) taken[slot[w]] = true; });
+		slot[v] = static_cast<uint32_t>(std::find(taken.begin(), taken.end(), false) - taken.begin());
+		if (slot[v] == slot_names.size()) slot_names.push_back(variables[v]);
+	}
+
+	for (auto i : instructions) {
+		for_each_variable_operand(program, code[i], [&](mcasm_operand& o, operand_role) {
+			auto found = variable_index.find(o.name);
+			if (found != variable_index.end()) o.name = slot_names[slot[found->second]];
+		});
+	}
+}
+
+void reuse_dead_variables(mcasm_program& program) {
+	program_analysis analysis(program);
+	for (uint32_t region = 0; region < analysis.parent_region.size(); region++) {
+		reuse_dead_variables(program, analysis, region);
+	}
+}
+
+// functions at most this big (in instructions, not counting labels) are inlined wherever they're called. bigger ones are only inlined if there's just the one call.
+constexpr size_t inline_size_limit = 16;
+
+void inline_functions(mcasm_program& program) {
+	static int copies = 0; // of function bodies, to give each copy's names a different suffix
+
+	for (bool changed = true; changed;) {
+		changed = false;
+		program_analysis a(program);
+		auto functions = find_functions(program);
+		auto& code = program.code;
+
+		// only functions that don't call anything (or define functions) are inlined, so there's no recursion to deal with.
+		// inlining those can make their callers not call anything either, which is what repeating this is for.
+		std::unordered_map<symbol_id, size_t> call_sites;
+		for (auto& instr : code) {
+			if (instr.op != opcode::cfunc) continue;
+			auto callee = find_callee(program, a, functions, instr[0].name);
+			if (callee != no_symbol) call_sites[callee]++;
+		}
+		std::unordered_map<symbol_id, bool> inlinable;
+		for (auto& [name, definition] : functions) {
+			size_t size = 0;
+			bool leaf = true;
+			for (uint32_t i = definition.start + 1; i < definition.end; i++) {
+				size += code[i].op != opcode::label;
+				leaf &= code[i].op != opcode::cfunc && code[i].op != opcode::dfunc;
+			}
+			inlinable[name] = leaf && (size <= inline_size_limit || call_sites[name] == 1);
+		}
+
+		std::vector<instruction> result;
+		result.reserve(code.size());
+		for (uint32_t i = 0; i < code.size(); i++) {
+			auto& call = code[i];
+			symbol_id callee = call.op == opcode::cfunc ? find_callee(program, a, functions, call[0].name) : no_symbol;
+			if (callee == no_symbol || !inlinable[callee]) {
+				result.push_back(call);
+				continue;
+			}
+			auto& definition = functions.at(callee);
+			auto parameters = program.lists[code[definition.start][1].index], arguments = program.lists[call[1].index]; // (copies, the lists get added to)
+			if (parameters.size() != arguments.size()) {
+				result.push_back(call);
+				continue;
+			}
+
+			// the copy gets its own labels, and its own versions of the function's variables (including the parameters). anything else it uses, like functions and outer variables, is the same as the function's.
+			copies++;
+			std::unordered_map<symbol_id, symbol_id> names;
+			auto copy_name = [&](symbol_id name) {
+				names[name] = interner.intern(std::string(interner.name(name)) + "_in" + std::to_string(copies));
+			};
+			for (uint32_t j = definition.start; j <= definition.end; j++) {
+				if (code[j].op == opcode::label) copy_name(code[j][0].name);
+				for_each_variable_operand(program, code[j], [&](mcasm_operand& o, operand_role) {
+					if (names.contains(o.name) || functions.contains(o.name)) return;
+					bool local = true;
+					for (auto& u : a.uses[o.name]) local &= u.instruction >= definition.start && u.instruction <= definition.end;
+					if (local) copy_name(o.name);
+				});
+			}
+			// (a parameter that's used outside of the function too, like one with the same name as another function's, can't be told apart from the other uses)
+			bool own_parameters = true;
+			for (auto& parameter : parameters) own_parameters &= names.contains(parameter.name);
+			if (!own_parameters) {
+				result.push_back(call);
+				continue;
+			}
+
+			// calling binds the parameters to the arguments' values
+			for (size_t k = 0; k < parameters.size(); k++) {
+				result.push_back(instruction{ .op = opcode::dvar, .operand_count = 2, .operands = { mcasm_operand::variable(names.at(parameters[k].name)), arguments[k] } });
+			}
+			for (uint32_t j = definition.start + 1; j < definition.end; j++) {
+				instruction copy = code[j];
+				for (size_t k = 0; k < copy.operand_count; k++) {
+					auto& o = copy.operands[k];
+					if (o.kind == mcasm_operand::kind_t::arguments) { // (the list is renamed too, so it needs its own)
+						auto elements = program.lists[o.index];
+						o = program.arguments(std::move(elements));
+					}
+					else if (o.kind == mcasm_operand::kind_t::label) o.name = names.at(o.name);
+				}
+				for_each_variable_operand(program, copy, [&](mcasm_operand& o, operand_role) {
+					auto found = names.find(o.name);
+					if (found != names.end()) o.name = found->second;
+				});
+				result.push_back(copy);
+			}
+			changed = true;
+		}
+		code = std::move(result);
+	}
+}
+
+// instructions that can be moved out of a loop when their operands don't change in it: ones that only work out their result, and can't fail.
+// (they might not have run at all where they were, so one that fails, like converting a number that's too big for an int or taking the length of something that isn't an array, has to stay put)
+static bool is_hoistable(opcode op) {
+	if (op == opcode::f2s || op == opcode::f2u || op == opcode::d2s || op == opcode::d2u) return false;
+	return is_pure(op) && op != opcode::dvar && op != opcode::cvar && op != opcode::garr && op != opcode::garrl;
+}
+
+// moves the instructions that work out a temporary out of a loop (to right before it), if they'd work out the same thing on every iteration.
+// returns whether it moved anything. (then the analysis is out of date)
+static bool hoist_loop_invariants(mcasm_program& program, const program_analysis& a, alias_classes& aliases, uint32_t top, uint32_t bottom) {
+	auto& code = program.code;
+	auto in_loop = [&](uint32_t i) { return i >= top && i <= bottom; };
+
+	// the loop has to only be entered at the top. and if it calls anything, the called functions could change whatever they can name.
+	bool calls = false;
+	for (uint32_t i = top; i <= bottom; i++) {
+		auto& instr = code[i];
+		if (instr.op == opcode::dfunc || instr.op == opcode::endfunc) return false;
+		calls |= instr.op == opcode::cfunc;
+		if (instr.op == opcode::label) {
+			for (auto jump : a.jumps.at(instr[0].name)) {
+				if (!in_loop(jump)) return false;
+			}
+		}
+	}
+
+	// whether something in the loop, other than instructions from..to, could change the value v has
+	auto value_changes = [&](symbol_id v, uint32_t from, uint32_t to) {
+		if (calls && aliases.unknown_aliases(v)) return true;
+		for (auto alias : aliases.aliases(v)) {
+			for (auto& u : a.uses[alias]) {
+				if (!writes(u.role) || (u.instruction >= from && u.instruction <= to)) continue;
+				auto op = code[u.instruction].op;
+				bool rebinding = op == opcode::dvar || op == opcode::cvar || u.role == operand_role::parameter; // (which doesn't change the value it had)
+				if (in_loop(u.instruction) && !rebinding) return true;
+				if (calls && a.region[u.instruction] != a.region[top]) return true;
+			}
+		}
+		return false;
+	};
+
+	// whether the operand is the same on every iteration
+	auto invariant = [&](const mcasm_operand& o) {
+		if (!names_variable(o)) return true;
+		for (auto& u : a.uses[o.name]) {
+			if (in_loop(u.instruction) && writes(u.role)) return false;
+		}
+		return !value_changes(o.name, UINT32_MAX, 0);
+	};
+
+	for (uint32_t i = top; i <= bottom; i++) {
+		// a temporary declared in the loop, and then either copied into or worked out straight away
+		auto& declaration = code[i];
+		uint32_t end = i;
+		symbol_id t;
+		if (declaration.op == opcode::cvar) {
+			t = declaration[1].name;
+			if (!invariant(declaration[0])) continue;
+		}
+		else if (declaration.op == opcode::dvar && declaration[1].is_immediate() && i < bottom && is_hoistable(code[i + 1].op)) {
+			t = declaration[0].name;
+			end = i + 1;
+			auto& work = code[end];
+			bool ok = true;
+			auto roles = operand_roles(work.op);
+			for (size_t j = 0; j < work.operand_count; j++) {
+				if (work[j].is_immediate()) continue; // (which is invariant, and has no name to look at)
+				if (writes(roles[j])) ok &= work[j].name == t;
+				else ok &= work[j].name != t && invariant(work[j]);
+			}
+			if (!ok) continue;
+		}
+		else continue;
+
+		// it has to be the loop's own, and only ever be given that value
+		auto& ut = a.uses[t];
+		bool ok = ut.front().instruction == i;
+		for (auto& u : ut) ok &= in_loop(u.instruction) && (!writes(u.role) || u.instruction <= end);
+		if (!ok || value_changes(t, i, end)) continue;
+
+		std::vector<instruction> moved(code.begin() + i, code.begin() + end + 1);
+		code.erase(code.begin() + i, code.begin() + end + 1);
+		code.insert(code.begin() + top, moved.begin(), moved.end());
+		return true;
+	}
+	return false;
+}
+
+void hoist_loop_invariants(mcasm_program& program) {
+	for (bool changed = true; changed;) {
+		changed = false;
+		program_analysis a(program);
+		auto functions = find_functions(program);
+
+		// a symbol made from a number could be any variable, so then nothing can be assumed about aliases
+		for (auto& instr : program.code) {
+			if (instr.op == opcode::s2sym || instr.op == opcode::u2sym) return;
+		}
+		alias_classes aliases(program, a, functions);
+
+		// each jump back up to a label is a loop, from the label to the jump
+		for (uint32_t i = 0; i < program.code.size() && !changed; i++) {
+			auto& jump = program.code[i];
+			if (jump.op != opcode::jmp && !is_conditional_jump(jump.op)) continue;
+			uint32_t top = a.labels.at(jump[0].name);
+			if (top < i && a.region[top] == a.region[i]) changed = hoist_loop_invariants(program, a, aliases, top, i);
+		}
+	}
+}
+
+void optimize(mcasm_program& program) {
+	eliminate_redundant_code(program);
+	inline_functions(program);
+	eliminate_redundant_code(program);
+	hoist_loop_invariants(program);
+	eliminate_redundant_code(program);
+	reuse_dead_variables(program);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "mcasm.h"
+
+// passes over the generated MCASM, run once the whole program has been generated (see main).
+// MCASM's variables work a bit differently from the script's, and the passes have to keep them working the same (see mcasm/program5.mcasm):
+//  - "dvar x sym:y" makes x another name for y's value, like a reference. it doesn't copy it.
+//  - "cvar x y" makes y a new copy of x's value, even if y was another name for something else before.
+//  - everything else that writes to a variable (arithmetic, conversions...) writes into whatever value it names.
+
+// removes stores that nothing reads, and makes results go straight into the variables they end up in instead of through temporaries and copies.
+void eliminate_redundant_code(mcasm_program& program);
+
+// replaces calls to small functions (and to functions that are only called once) with a copy of the function's body, when it doesn't call anything itself.
+// the copy's parameters are bound to the arguments like the call would have bound them, and its labels and variables are renamed so each copy has its own.
+// run eliminate_redundant_code afterwards, which cleans up after it (and removes the functions nothing calls anymore).
+void inline_functions(mcasm_program& program);
+
+// moves arithmetic, conversions and copies that work out the same thing on every iteration of a loop to before it.
+// aliasing is taken into account: a value doesn't count as unchanged if it could be changed through another name for it, including by any functions the loop calls.
+void hoist_loop_invariants(mcasm_program& program);
+
+// gives variables that are never alive at the same time the same name, within each function (and the top level), so each frame needs only as many variables as are ever alive at once.
+// run after eliminate_redundant_code, which relies on each variable only being one thing.
+void reuse_dead_variables(mcasm_program& program);
+
+// all of the above, in the order they work best in
+void optimize(mcasm_program& program);
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// bulk scanning for the parts of the script the lexer doesn't care about the contents of: whitespace runs, comments and string literals.
+// uses AVX2 when the compiler is allowed to (/arch:AVX2, -mavx2), SSE2 on any other x86-64 build, and plain loops everywhere else.
+// every function takes [p, end) and counts the newlines it walks over into newlines, so the tokenizer never has to look at those bytes again.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TOOLA_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TOOLA_SIMD_SSE2
+#endif
+
+namespace simd_detail {
+
+#if defined(TOOLA_SIMD_AVX2)
+
+	// 32 bytes of the script, comparisons return one bit per byte
+	struct byte_block {
+		static constexpr size_t width = 32;
+		static constexpr uint32_t all = 0xFFFFFFFFu;
+
+		__m256i bytes;
+
+		static byte_block load(const char* p) { return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) }; }
+
+		uint32_t equal(char c) const {
+			return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c))));
+		}
+
+		// ' ' or '\t' '\n' '\v' '\f' '\r' (0x09-0x0D, tested as unsigned (c - 9) <= 4)
+		uint32_t whitespace() const {
+			__m256i shifted = _mm256_sub_epi8(bytes, _mm256_set1_epi8(9));
+			__m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+			__m256i space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+			return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(control, space)));
+		}
+	};
+
+#elif defined(TOOLA_SIMD_SSE2)
+
+	// 16 bytes of the script, comparisons return one bit per byte
+	struct byte_block {
+		static constexpr size_t width = 16;
+		static constexpr uint32_t all = 0xFFFFu;
+
+		__m128i bytes;
+
+		static byte_block load(const char* p) { return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) }; }
+
+		uint32_t equal(char c) const {
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c))));
+		}
+
+		// ' ' or '\t' '\n' '\v' '\f' '\r' (0x09-0x0D, tested as unsigned (c - 9) <= 4)
+		uint32_t whitespace() const {
+			__m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8(9));
+			__m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+			__m128i space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(control, space)));
+		}
+	};
+
+#endif
+
+	inline bool is_whitespace(char c) {
+		return c == ' ' || (static_cast<uint8_t>(c) - 9u) <= 4u;
+	}
+
+	// mask with the lowest n bits set (n < 32)
+	inline uint32_t bits_below(int n) {
+		return (1u << n) - 1u;
+	}
+}
+
+// first character at or after p that isn't whitespace, or end
+inline const char* skip_whitespace(const char* p, const char* end, int& newlines) {
+	// most runs are a single space between two tokens, or none at all
+	if (p != end && !simd_detail::is_whitespace(*p)) return p;
+	if (end - p >= 2 && *p == ' ' && !simd_detail::is_whitespace(p[1])) return p + 1;
+#if defined(TOOLA_SIMD_AVX2) || defined(TOOLA_SIMD_SSE2)
+	using simd_detail::byte_block;
+	while (static_cast<size_t>(end - p) >= byte_block::width) {
+		auto block = byte_block::load(p);
+		uint32_t spaces = block.whitespace();
+		uint32_t line_breaks = block.equal('\n');
+		if (spaces == byte_block::all) {
+			newlines += std::popcount(line_breaks);
+			p += byte_block::width;
+			continue;
+		}
+		int stop = std::countr_zero(~spaces);
+		newlines += std::popcount(line_breaks & simd_detail::bits_below(stop));
+		return p + stop;
+	}
+#endif
+	for (; p != end && simd_detail::is_whitespace(*p); p++) {
+		if (*p == '\n') newlines++;
+	}
+	return p;
+}
+
+// the '\n' ending a line comment, or end if the comment runs into <eof>. the '\n' itself is left for skip_whitespace to count.
+inline const char* find_line_end(const char* p, const char* end) {
+#if defined(TOOLA_SIMD_AVX2) || defined(TOOLA_SIMD_SSE2)
+	using simd_detail::byte_block;
+	while (static_cast<size_t>(end - p) >= byte_block::width) {
+		uint32_t line_breaks = byte_block::load(p).equal('\n');
+		if (line_breaks) return p + std::countr_zero(line_breaks);
+		p += byte_block::width;
+	}
+#endif
+	for (; p != end && *p != '\n'; p++);
+	return p;
+}
+
+// p is just after the "/*". returns the character after the closing "*/", or nullptr if the comment is never closed.
+inline const char* find_block_comment_end(const char* p, const char* end, int& newlines) {
+#if defined(TOOLA_SIMD_AVX2) || defined(TOOLA_SIMD_SSE2)
+	using simd_detail::byte_block;
+	// compare each byte for '*' and the byte after it for '/' at once, so "*/" split across two blocks is still found
+	while (static_cast<size_t>(end - p) > byte_block::width) {
+		auto block = byte_block::load(p);
+		uint32_t closings = block.equal('*') & byte_block::load(p + 1).equal('/');
+		uint32_t line_breaks = block.equal('\n');
+		if (closings) {
+			int stop = std::countr_zero(closings);
+			newlines += std::popcount(line_breaks & simd_detail::bits_below(stop));
+			return p + stop + 2;
+		}
+		newlines += std::popcount(line_breaks);
+		p += byte_block::width;
+	}
+#endif
+	for (; p != end; p++) {
+		if (*p == '\n') newlines++;
+		else if (*p == '*' && p + 1 != end && p[1] == '/') return p + 2;
+	}
+	return nullptr;
+}
+
+// p is just after the opening quote. returns the closing quote, or nullptr if the string is never closed.
+// a backslash always escapes the character after it, even a newline.
+inline const char* find_string_end(const char* p, const char* end, int& newlines) {
+#if defined(TOOLA_SIMD_AVX2) || defined(TOOLA_SIMD_SSE2)
+	using simd_detail::byte_block;
+	while (static_cast<size_t>(end - p) >= byte_block::width) {
+		auto block = byte_block::load(p);
+		uint32_t specials = block.equal('"') | block.equal('\\');
+		uint32_t line_breaks = block.equal('\n');
+		if (!specials) {
+			newlines += std::popcount(line_breaks);
+			p += byte_block::width;
+			continue;
+		}
+		int stop = std::countr_zero(specials);
+		newlines += std::popcount(line_breaks & simd_detail::bits_below(stop));
+		p += stop;
+		if (*p == '"') return p;
+
+		// skip the escape and whatever it escapes, then keep scanning from there
+		if (p + 1 == end) return nullptr;
+		if (p[1] == '\n') newlines++;
+		p += 2;
+	}
+#endif
+	for (; p != end; p++) {
+		if (*p == '"') return p;
+		if (*p == '\\') {
+			if (p + 1 == end) return nullptr;
+			p++;
+		}
+		if (*p == '\n') newlines++;
+	}
+	return nullptr;
+}
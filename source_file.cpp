@@ -0,0 +1,94 @@
+#include "source_file.h"
+
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+source_file::source_file(std::string path) {
+	file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		file_handle = nullptr;
+		std::cout << "Failure to open " << path << "\n";
+		throw std::runtime_error("Invalid path " + path);
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size)) {
+		CloseHandle(file_handle);
+		throw std::runtime_error("could not get size of " + path);
+	}
+
+	// can't map an empty file, but an empty script is still a valid script
+	if (file_size.QuadPart == 0) return;
+
+	mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_handle == nullptr) {
+		CloseHandle(file_handle);
+		throw std::runtime_error("could not map " + path);
+	}
+
+	auto view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		throw std::runtime_error("could not map " + path);
+	}
+
+	data = static_cast<const char*>(view);
+	size = static_cast<size_t>(file_size.QuadPart);
+}
+
+source_file::~source_file() {
+	if (size > 0) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+}
+
+#else
+
+source_file::source_file(std::string path) {
+	file_descriptor = open(path.c_str(), O_RDONLY);
+	if (file_descriptor < 0) {
+		std::cout << "Failure to open " << path << "\n";
+		throw std::runtime_error("Invalid path " + path);
+	}
+
+	struct stat file_info;
+	if (fstat(file_descriptor, &file_info) != 0) {
+		close(file_descriptor);
+		throw std::runtime_error("could not get size of " + path);
+	}
+
+	// can't map an empty file, but an empty script is still a valid script
+	if (file_info.st_size == 0) return;
+
+	void* view = mmap(nullptr, file_info.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	if (view == MAP_FAILED) {
+		close(file_descriptor);
+		throw std::runtime_error("could not map " + path);
+	}
+	// the tokenizer only ever walks forwards (rewinds are short), so let the kernel read ahead
+	madvise(view, file_info.st_size, MADV_SEQUENTIAL);
+
+	data = static_cast<const char*>(view);
+	size = static_cast<size_t>(file_info.st_size);
+}
+
+source_file::~source_file() {
+	if (size > 0) munmap(const_cast<char*>(data), size);
+	if (file_descriptor >= 0) close(file_descriptor);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// read-only memory mapping of a script.
+// tokens are std::string_views into the mapping, so this has to outlive every token handed out by the tokenizer.
+class source_file {
+public:
+	// throws if the file can't be opened or mapped
+	source_file(std::string path);
+	~source_file();
+
+	source_file(const source_file&) = delete;
+	source_file& operator=(const source_file&) = delete;
+
+	std::string_view text() const { return std::string_view(data, size); }
+
+private:
+	const char* data = "";
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#else
+	int file_descriptor = -1;
+#endif
+};
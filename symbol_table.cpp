@@ -0,0 +1,21 @@
+#include "symbol_table.h"
+
+#include <algorithm>
+#include <cassert>
+
+void symbol_table::declare(binding b) {
+	assert(b.symbol != no_symbol);
+	if (b.symbol >= innermost.size()) innermost.resize(std::max<size_t>(b.symbol + 1, innermost.size() * 2), none);
+
+	b.shadowed = innermost[b.symbol];
+	innermost[b.symbol] = static_cast<uint32_t>(bindings.size());
+	bindings.push_back(b);
+}
+
+void symbol_table::undo(size_t mark) {
+	assert(mark <= bindings.size());
+	while (bindings.size() > mark) {
+		innermost[bindings.back().symbol] = bindings.back().shadowed;
+		bindings.pop_back();
+	}
+}
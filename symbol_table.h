@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "interner.h"
+
+struct _type_info;
+class varname;
+
+enum class symbol_type {
+	variable, // (functions are variables too)
+	type
+};
+
+// every name that's currently in scope, in one table indexed by symbol ID, so looking a name up doesn't depend on how deeply nested we are.
+// declaring a name pushes a binding that hides any outer one with the same name, and leaving a scope pops the bindings made inside it.
+class symbol_table {
+public:
+	struct binding {
+		symbol_id symbol;
+		symbol_type kind;
+		varname* variable = nullptr; // if kind is variable
+		_type_info* type = nullptr; // if kind is type
+		uint32_t shadowed = none; // the binding of the same name that this one hides
+	};
+
+	static constexpr uint32_t none = UINT32_MAX;
+
+	// innermost binding of the name, nullptr if it's not in scope
+	const binding* find(symbol_id symbol) const {
+		if (symbol >= innermost.size() || innermost[symbol] == none) return nullptr;
+		return &bindings[innermost[symbol]];
+	}
+
+	void declare_variable(symbol_id symbol, varname* variable) { declare({ .symbol = symbol, .kind = symbol_type::variable, .variable = variable }); }
+	void declare_type(symbol_id symbol, _type_info* type) { declare({ .symbol = symbol, .kind = symbol_type::type, .type = type }); }
+
+	// remember this when entering a scope and give it to undo() when leaving it
+	size_t mark() const { return bindings.size(); }
+
+	// removes every binding made since the mark, unhiding whatever they hid
+	void undo(size_t mark);
+
+private:
+	std::vector<binding> bindings; // in declaration order, which doubles as the undo log
+	std::vector<uint32_t> innermost; // indexed by symbol ID, index into bindings or none
+
+	void declare(binding b);
+};
@@ -50,6 +50,10 @@ var joe = function i32(A& obj, string str) {
 	
 	}
 
+	for (i32 forever = 0, , forever += 1) {
+	
+	}
+
 	//for (i32 dier = 1, dier > -4, dier -= 1) {
 	
 	//}